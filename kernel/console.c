@@ -89,11 +89,11 @@ consoleread(int user_dst, uint64 dst, int n)
     // wait until interrupt handler has put some
     // input into cons.buffer.
     while(cons.r == cons.w){
-      if(myproc()->killed){
+      if(signal_pending(myproc())){
         release(&cons.lock);
         return -1;
       }
-      sleep(&cons.r, &cons.lock);
+      sleep_intr(&cons.r, &cons.lock);
     }
 
     c = cons.buf[cons.r++ % INPUT_BUF];
@@ -8,6 +8,8 @@ struct spinlock;
 struct sleeplock;
 struct stat;
 struct superblock;
+struct timer;
+struct vdso;
 
 // bio.c
 void            binit(void);
@@ -81,15 +83,37 @@ void            printf(char*, ...);
 void            panic(char*) __attribute__((noreturn));
 void            printfinit(void);
 
+// prof.c
+void            profinit(void);
+void            prof_tick(int, uint64, uint64);
+int             prof(int, int, uint64);
+
+// trace.c
+void            traceinit(void);
+void            trace(int, uint64, uint64);
+int             ktrace(int, int, uint64);
+
+// klog.c
+void            kloginit(void);
+void            klog(int, char*, ...);
+int             setloglevel(int);
+int             dmesg(uint64, int);
+
 // proc.c
 int             cpuid(void);
 void            exit(int);
 int             fork(void);
 int             growproc(int);
-void            proc_mapstacks(pagetable_t);
 pagetable_t     proc_pagetable(struct proc *);
 void            proc_freepagetable(pagetable_t, uint64);
 int             kill(int, int);
+int             sigqueue(int, int, uint64);
+uint64          sigdequeue(struct proc*, int);
+int             sigtake(uint, uint64*, int);
+int             sigfdread(uint, uint64, int);
+int             setitimer(uint, uint);
+int             setpgid(int, int);
+int             getpgid(int);
 struct cpu*     mycpu(void);
 struct cpu*     getmycpu(void);
 struct proc*    myproc();
@@ -98,16 +122,25 @@ void            scheduler(void) __attribute__((noreturn));
 void            sched(void);
 void            setproc(struct proc*);
 void            sleep(void*, struct spinlock*);
+void            sleep_intr(void*, struct spinlock*);
+int             signal_pending(struct proc*);
 void            userinit(void);
 int             wait(uint64);
+int             waitpid(int, uint64, int);
 void            wakeup(void*);
 void            yield(void);
 int             either_copyout(int user_dst, uint64 dst, void *src, uint64 len);
 int             either_copyin(void *dst, int user_src, uint64 src, uint64 len);
 void            procdump(void);
+int             setnice(int, int);
 uint            sigprocmask(uint);
 int             sigaction(int, uint64 act_addr, uint64 old_act_addr);
-void            sigret(void);
+int             sigret(void);
+void*           sigdefault(int);
+int             sigkernel(void*);
+
+// start.c
+int             timer_fired(void);
 
 // swtch.S
 void            swtch(struct context*, struct context*);
@@ -143,11 +176,18 @@ int             fetchstr(uint64, char*, int);
 int             fetchaddr(uint64, uint64*);
 void            syscall();
 
+// timer.c
+void            timer_add(struct timer*, uint);
+void            timer_del(struct timer*);
+int             timer_pending(struct timer*);
+void            timer_tick(void);
+
 // trap.c
 extern uint     ticks;
 void            trapinit(void);
 void            trapinithart(void);
 extern struct spinlock tickslock;
+extern struct vdso *vdso;
 void            usertrapret(void);
 
 // uart.c
@@ -161,6 +201,8 @@ int             uartgetc(void);
 void            kvminit(void);
 void            kvminithart(void);
 void            kvmmap(pagetable_t, uint64, uint64, uint64, int);
+int             kvmallocpage(uint64);
+void            kvmfreepage(uint64);
 int             mappages(pagetable_t, uint64, uint64, uint64, int);
 pagetable_t     uvmcreate(void);
 void            uvminit(pagetable_t, uchar *, uint);
@@ -170,6 +212,7 @@ int             uvmcopy(pagetable_t, pagetable_t, uint64);
 void            uvmfree(pagetable_t, uint64);
 void            uvmunmap(pagetable_t, uint64, uint64, int);
 void            uvmclear(pagetable_t, uint64);
+pte_t *         walk(pagetable_t, uint64, int);
 uint64          walkaddr(pagetable_t, uint64);
 int             copyout(pagetable_t, uint64, char *, uint64);
 int             copyin(pagetable_t, char *, uint64, uint64);
@@ -188,3 +231,6 @@ void            virtio_disk_intr(void);
 
 // number of elements in fixed-size array
 #define NELEM(x) (sizeof(x)/sizeof((x)[0]))
+
+// byte offset of member within struct type
+#define offsetof(type, member) __builtin_offsetof(type, member)
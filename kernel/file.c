@@ -122,6 +122,8 @@ fileread(struct file *f, uint64 addr, int n)
     if((r = readi(f->ip, 1, addr, f->off, n)) > 0)
       f->off += r;
     iunlock(f->ip);
+  } else if(f->type == FD_SIGNAL){
+    r = sigfdread(f->sigmask, addr, n);
   } else {
     panic("fileread");
   }
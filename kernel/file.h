@@ -1,5 +1,5 @@
 struct file {
-  enum { FD_NONE, FD_PIPE, FD_INODE, FD_DEVICE } type;
+  enum { FD_NONE, FD_PIPE, FD_INODE, FD_DEVICE, FD_SIGNAL } type;
   int ref; // reference count
   char readable;
   char writable;
@@ -7,6 +7,7 @@ struct file {
   struct inode *ip;  // FD_INODE and FD_DEVICE
   uint off;          // FD_INODE
   short major;       // FD_DEVICE
+  uint sigmask;      // FD_SIGNAL
 };
 
 #define major(dev)  ((dev) >> 16 & 0xFFFF)
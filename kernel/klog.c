@@ -0,0 +1,122 @@
+//
+// kernel log -- klog, dmesg.
+//
+// klog() formats into a ring buffer belonging to the
+// calling CPU rather than out the UART, so it is cheap
+// enough for hot paths such as signal delivery, and it
+// does nothing at all unless the log level asks for it.
+// dmesg() copies the rings out to user space.
+//
+
+#include <stdarg.h>
+
+#include "types.h"
+#include "param.h"
+#include "spinlock.h"
+#include "riscv.h"
+#include "proc.h"
+#include "klog.h"
+#include "defs.h"
+
+void vprintfmt(void (*)(int, void*), void*, char*, va_list);
+
+int klog_level = KLOG_OFF;
+
+static struct klogbuf {
+  struct spinlock lock;  // contended only by dmesg()
+  uint64 head;           // bytes ever written
+  char buf[KLOGSIZE];
+} klogbuf[NCPU];
+
+void
+kloginit(void)
+{
+  for(int i = 0; i < NCPU; i++)
+    initlock(&klogbuf[i].lock, "klog");
+}
+
+static void
+klogputc(int c, void *arg)
+{
+  struct klogbuf *b = arg;
+
+  b->buf[b->head++ % KLOGSIZE] = c;
+}
+
+static void
+klogfmt(struct klogbuf *b, char *fmt, ...)
+{
+  va_list ap;
+
+  va_start(ap, fmt);
+  vprintfmt(klogputc, b, fmt, ap);
+  va_end(ap);
+}
+
+// Record a message at the given level in this CPU's ring,
+// if klog_level lets it through. only understands
+// %d, %x, %p, %s.
+void
+klog(int level, char *fmt, ...)
+{
+  va_list ap;
+  struct klogbuf *b;
+
+  if(level > klog_level)
+    return;
+
+  push_off();
+  b = &klogbuf[cpuid()];
+  acquire(&b->lock);
+  pop_off();
+
+  klogfmt(b, "[%d] ", ticks);
+  va_start(ap, fmt);
+  vprintfmt(klogputc, b, fmt, ap);
+  va_end(ap);
+
+  release(&b->lock);
+}
+
+// Set the level below which klog() records messages.
+// Returns the old level.
+int
+setloglevel(int level)
+{
+  int old = klog_level;
+
+  klog_level = level;
+  return old;
+}
+
+// Copy up to n bytes of log to user address addr,
+// one CPU's ring after another, oldest first.
+// Returns the number of bytes copied, or -1.
+int
+dmesg(uint64 addr, int n)
+{
+  struct proc *p = myproc();
+  struct klogbuf *b;
+  uint64 start;
+  int off, len, i, m;
+
+  off = 0;
+  for(b = klogbuf; b < &klogbuf[NCPU] && off < n; b++){
+    acquire(&b->lock);
+    start = b->head > KLOGSIZE ? b->head - KLOGSIZE : 0;
+    len = b->head - start;
+    if(len > n - off)
+      len = n - off;
+    // the ring may wrap: copy the end of buf, then the start.
+    i = start % KLOGSIZE;
+    m = len < KLOGSIZE - i ? len : KLOGSIZE - i;
+    if(copyout(p->pagetable, addr + off, b->buf + i, m) < 0 ||
+       copyout(p->pagetable, addr + off + m, b->buf, len - m) < 0){
+      release(&b->lock);
+      return -1;
+    }
+    release(&b->lock);
+    off += len;
+  }
+  return off;
+}
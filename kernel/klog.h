@@ -0,0 +1,5 @@
+// klog() levels; a message is recorded if its level is
+// no higher than the one set with setloglevel().
+#define KLOG_OFF    0  // record nothing (the default)
+#define KLOG_INFO   1  // occasional events
+#define KLOG_TRACE  2  // per-signal and other hot-path events
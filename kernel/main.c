@@ -13,6 +13,9 @@ main()
   if(cpuid() == 0){
     consoleinit();
     printfinit();
+    kloginit();      // per-CPU kernel log rings
+    profinit();      // per-CPU profiler sample buffers
+    traceinit();     // per-CPU tracepoint rings
     printf("\n");
     printf("xv6 kernel is booting\n");
     printf("\n");
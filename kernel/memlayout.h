@@ -25,10 +25,14 @@
 #define VIRTIO0 0x10001000
 #define VIRTIO0_IRQ 1
 
-// core local interruptor (CLINT), which contains the timer.
+// core local interruptor (CLINT), which contains the timer
+// and the machine software interrupt (IPI) registers.
 #define CLINT 0x2000000L
+#define CLINT_MSIP(hartid) (CLINT + 4*(hartid))
 #define CLINT_MTIMECMP(hartid) (CLINT + 0x4000 + 8*(hartid))
 #define CLINT_MTIME (CLINT + 0xBFF8) // cycles since boot.
+#define MTIME_FREQ 10000000L // CLINT_MTIME cycles per second in qemu.
+#define TICKINTERVAL 1000000 // cycles per clock tick; about 1/10th second.
 
 // qemu puts platform-level interrupt controller (PLIC) here.
 #define PLIC 0x0c000000L
@@ -62,6 +66,24 @@
 //   fixed-size stack
 //   expandable heap
 //   ...
+//   VDSO (struct vdso, read-only, shared by all processes)
+//   USYSCALL (struct usyscall, read-only, per process)
+//   SIGTRAMPOLINE (sigtramp.S, where signal handlers return)
 //   TRAPFRAME (p->trapframe, used by the trampoline)
 //   TRAMPOLINE (the same page as in the kernel)
 #define TRAPFRAME (TRAMPOLINE - PGSIZE)
+#define SIGTRAMPOLINE (TRAPFRAME - PGSIZE)
+#define USYSCALL (SIGTRAMPOLINE - PGSIZE)
+#define VDSO (USYSCALL - PGSIZE)
+
+// what the kernel publishes at USYSCALL and VDSO, so
+// that ulib.c can answer getpid() and uptime()
+// without a system call.
+struct usyscall {
+  int pid;          // this process's pid
+};
+
+struct vdso {
+  uint ticks;       // copy of ticks, kept up by clockintr()
+  uint64 timefreq;  // time CSR increments per second
+};
@@ -1,5 +1,14 @@
-#define NPROC        64  // maximum number of processes
+#define NPROC      4096  // maximum number of processes
+#define NSTACKCACHE  64  // kernel stacks kept mapped on unused procs
 #define NCPU          8  // maximum number of CPUs
+#define NSLEEPQ      61  // buckets in the sleep channel hash
+#define NPIDHASH     61  // buckets in the pid hash
+#define NTIMERSLOT   64  // slots in the clock tick timing wheel
+#define NICE_MIN    -20  // nice value with the largest CPU share
+#define NICE_MAX     19  // nice value with the smallest CPU share
+#define NSIGQUEUE    32  // queued signals per process (sigqueue)
+#define KLOGSIZE   4096  // bytes of kernel log kept per CPU
+#define NTRACE      256  // trace records kept per CPU
 #define NOFILE       16  // open files per process
 #define NFILE       100  // open files per system
 #define NINODE       50  // maximum number of active i-nodes
@@ -26,7 +26,7 @@ static struct {
 static char digits[] = "0123456789abcdef";
 
 static void
-printint(int xx, int base, int sign)
+printint(void (*putc)(int, void*), void *arg, int xx, int base, int sign)
 {
   char buf[16];
   int i;
@@ -46,38 +46,34 @@ printint(int xx, int base, int sign)
     buf[i++] = '-';
 
   while(--i >= 0)
-    consputc(buf[i]);
+    putc(buf[i], arg);
 }
 
 static void
-printptr(uint64 x)
+printptr(void (*putc)(int, void*), void *arg, uint64 x)
 {
   int i;
-  consputc('0');
-  consputc('x');
+  putc('0', arg);
+  putc('x', arg);
   for (i = 0; i < (sizeof(uint64) * 2); i++, x <<= 4)
-    consputc(digits[x >> (sizeof(uint64) * 8 - 4)]);
+    putc(digits[x >> (sizeof(uint64) * 8 - 4)], arg);
 }
 
-// Print to the console. only understands %d, %x, %p, %s.
+// Format fmt, passing each character to putc(c, arg).
+// only understands %d, %x, %p, %s.
+// shared by printf() and klog().
 void
-printf(char *fmt, ...)
+vprintfmt(void (*putc)(int, void*), void *arg, char *fmt, va_list ap)
 {
-  va_list ap;
-  int i, c, locking;
+  int i, c;
   char *s;
 
-  locking = pr.locking;
-  if(locking)
-    acquire(&pr.lock);
-
   if (fmt == 0)
     panic("null fmt");
 
-  va_start(ap, fmt);
   for(i = 0; (c = fmt[i] & 0xff) != 0; i++){
     if(c != '%'){
-      consputc(c);
+      putc(c, arg);
       continue;
     }
     c = fmt[++i] & 0xff;
@@ -85,30 +81,52 @@ printf(char *fmt, ...)
       break;
     switch(c){
     case 'd':
-      printint(va_arg(ap, int), 10, 1);
+      printint(putc, arg, va_arg(ap, int), 10, 1);
       break;
     case 'x':
-      printint(va_arg(ap, int), 16, 1);
+      printint(putc, arg, va_arg(ap, int), 16, 1);
       break;
     case 'p':
-      printptr(va_arg(ap, uint64));
+      printptr(putc, arg, va_arg(ap, uint64));
       break;
     case 's':
       if((s = va_arg(ap, char*)) == 0)
         s = "(null)";
       for(; *s; s++)
-        consputc(*s);
+        putc(*s, arg);
       break;
     case '%':
-      consputc('%');
+      putc('%', arg);
       break;
     default:
       // Print unknown % sequence to draw attention.
-      consputc('%');
-      consputc(c);
+      putc('%', arg);
+      putc(c, arg);
       break;
     }
   }
+}
+
+static void
+printfputc(int c, void *arg)
+{
+  consputc(c);
+}
+
+// Print to the console. only understands %d, %x, %p, %s.
+void
+printf(char *fmt, ...)
+{
+  va_list ap;
+  int locking;
+
+  locking = pr.locking;
+  if(locking)
+    acquire(&pr.lock);
+
+  va_start(ap, fmt);
+  vprintfmt(printfputc, 0, fmt, ap);
+  va_end(ap);
 
   if(locking)
     release(&pr.lock);
@@ -5,6 +5,9 @@
 #include "spinlock.h"
 #include "proc.h"
 #include "defs.h"
+#include "wait.h"
+#include "klog.h"
+#include "trace.h"
 
 int is_valid_sigmask(uint);
 void sigkill_handler(int);
@@ -15,7 +18,25 @@ void sigdfl_handler(int);
 
 struct cpu cpus[NCPU];
 
-struct proc proc[NPROC];
+// struct procs are carved out of kalloc()ed pages on
+// demand and never given back; freeproc() puts a proc
+// on ptable.free for reuse. so a struct proc pointer
+// always points at some struct proc, though not
+// necessarily the same process, and lookups that drop
+// their lock recheck p->pid.
+// a proc is given a kernel stack slot the first time it
+// is handed out, and keeps it. up to NSTACKCACHE UNUSED
+// procs keep their stack page mapped, ready for reuse;
+// the rest give the page back to kalloc() until needed.
+struct {
+	struct spinlock lock;
+	struct proc *all;       // live (not UNUSED) processes
+	struct proc *free;      // UNUSED procs with a stack mapped
+	struct proc *bare;      // UNUSED procs without one
+	int nfree;              // procs on free
+	int nstacks;            // kernel stack slots handed out
+	int stackgen;           // bumped when a kernel stack is mapped
+} ptable;
 
 struct proc *initproc;
 
@@ -24,8 +45,10 @@ struct spinlock pid_lock;
 
 extern void forkret(void);
 static void freeproc(struct proc *p);
+static void itimer_expired(struct timer *t);
 
 extern char trampoline[]; // trampoline.S
+extern char sigtramp[]; // sigtramp.S
 
 // helps ensure that wakeups of wait()ing
 // parents are not lost. helps obey the
@@ -33,42 +56,174 @@ extern char trampoline[]; // trampoline.S
 // must be acquired before any p->lock.
 struct spinlock wait_lock;
 
+// sigtake() sleeps with this, as there is no
+// data of its own to protect.
+struct spinlock sigwait_lock;
+
+// sleep() links a process into the bucket chosen by
+// hashing its chan, so wakeup() only has to look at
+// processes that may be waiting on that channel.
+// a bucket's lock must be acquired before any p->lock.
+struct sleepq {
+	struct spinlock lock;
+	struct proc *head;
+} sleepq[NSLEEPQ];
+
+// pid -> proc index, kept up to date by allocproc()
+// and freeproc(). a process can't be freed while
+// it's in the index, so holding pidhash.lock keeps
+// a looked-up process alive.
+struct {
+	struct spinlock lock;
+	struct proc *bucket[NPIDHASH];
+} pidhash;
+
+// pgid -> members of the process group. a process is
+// in the index from fork() until exit(), so it can't be
+// freed while pgrp.lock is held, and kill() can signal
+// a whole group in one pass over one bucket.
+// must be acquired before any sleep queue or p->lock.
+struct {
+	struct spinlock lock;
+	struct proc *bucket[NPIDHASH];
+} pgrp;
+
 static handler *def_handlers[] = {
 	[SIGSTOP]  sigstop_handler,
 	[SIGKILL]  sigkill_handler,
 	[SIG_IGN]  sigign_handler,
 	[SIG_DFL]  sigkill_handler,
-	[SIGCONT]  sigcont_handler
+	[SIGCONT]  sigcont_handler,
+	[SIGCHLD]  sigign_handler
 };
 
-// Allocate a page for each process's kernel stack.
-// Map it high in memory, followed by an invalid
-// guard page.
-void
-proc_mapstacks(pagetable_t kpgtbl) {
-	struct proc *p;
-	
-	for(p = proc; p < &proc[NPROC]; p++) {
-		char *pa = kalloc();
-		if(pa == 0)
-			panic("kalloc");
-		uint64 va = KSTACK((int) (p - proc));
-		kvmmap(kpgtbl, va, (uint64)pa, PGSIZE, PTE_R | PTE_W);
-	}
+// the kernel handler that SIG_DFL stands for.
+void*
+sigdefault(int signum)
+{
+	if(def_handlers[signum])
+		return def_handlers[signum];
+	return sigkill_handler;
+}
+
+// is h one of the kernel's own dispositions, run by
+// check_pending_signals() rather than in user space?
+int
+sigkernel(void *h)
+{
+	return h == sigkill_handler || h == sigstop_handler
+		|| h == sigcont_handler || h == sigign_handler;
 }
 
 // initialize the proc table at boot time.
 void
 procinit(void)
 {
-	struct proc *p;
+	struct cpu *c;
 	
+	initlock(&ptable.lock, "ptable");
 	initlock(&pid_lock, "nextpid");
 	initlock(&wait_lock, "wait_lock");
-	for(p = proc; p < &proc[NPROC]; p++) {
-			initlock(&p->lock, "proc");
-			p->kstack = KSTACK((int) (p - proc));
+	initlock(&sigwait_lock, "sigwait");
+	initlock(&pidhash.lock, "pidhash");
+	initlock(&pgrp.lock, "pgrp");
+	for(c = cpus; c < &cpus[NCPU]; c++)
+		initlock(&c->rqlock, "runq");
+	for(int i = 0; i < NSLEEPQ; i++)
+		initlock(&sleepq[i].lock, "sleepq");
+}
+
+// Carve a fresh page into UNUSED procs on ptable.bare.
+// struct procs are never freed, so they are never
+// handed back. ptable.lock must be held.
+static int
+procgrow(void)
+{
+	struct proc *pg;
+	int i;
+
+	if((pg = (struct proc*)kalloc()) == 0)
+		return -1;
+	memset(pg, 0, PGSIZE);
+	for(i = 0; i < PGSIZE / sizeof(struct proc); i++){
+		initlock(&pg[i].lock, "proc");
+		pg[i].allnext = ptable.bare;
+		ptable.bare = &pg[i];
+	}
+	return 0;
+}
+
+// Take an UNUSED proc off the free list, or else off
+// the bare list, growing the table and mapping a kernel
+// stack for it if need be, and link it onto the list of
+// live processes.
+static struct proc*
+procget(void)
+{
+	struct proc *p;
+
+	acquire(&ptable.lock);
+	if((p = ptable.free) != 0){
+		ptable.free = p->allnext;
+		ptable.nfree--;
+	} else {
+		if(ptable.bare == 0 && procgrow() < 0)
+			goto bad;
+		p = ptable.bare;
+		if(p->kstack == 0){
+			// Stack slots sit high in memory, each
+			// followed by an invalid guard page.
+			if(ptable.nstacks >= NPROC)
+				goto bad;
+			p->kstack = KSTACK(ptable.nstacks);
+			ptable.nstacks++;
+		}
+		if(kvmallocpage(p->kstack) < 0)
+			goto bad;
+		ptable.stackgen++;
+		ptable.bare = p->allnext;
+	}
+
+	p->allnext = ptable.all;
+	if(ptable.all)
+		ptable.all->allprev = &p->allnext;
+	ptable.all = p;
+	p->allprev = &ptable.all;
+	release(&ptable.lock);
+	return p;
+
+bad:
+	release(&ptable.lock);
+	return 0;
+}
+
+// Unlink p from the live processes and put it on the
+// free list, or if that is full, free its stack and put
+// it on the bare list. p->lock must be held; whoever
+// takes p next will wait for it in allocproc().
+// p is no longer running on its stack: wait() has seen
+// it leave sched().
+static void
+procput(struct proc *p)
+{
+	acquire(&ptable.lock);
+	*p->allprev = p->allnext;
+	if(p->allnext)
+		p->allnext->allprev = p->allprev;
+	p->allprev = 0;
+	if(ptable.nfree < NSTACKCACHE){
+		p->allnext = ptable.free;
+		ptable.free = p;
+		ptable.nfree++;
+	} else {
+		// procget() bumps stackgen when it maps the slot
+		// again, so CPUs flush any stale TLB entry for
+		// it before running p.
+		kvmfreepage(p->kstack);
+		p->allnext = ptable.bare;
+		ptable.bare = p;
 	}
+	release(&ptable.lock);
 }
 
 // Must be called with interrupts disabled,
@@ -100,6 +255,208 @@ myproc(void) {
 	return p;
 }
 
+// CPU share weights for nice -20..19, as in Linux:
+// one step of nice is worth about 10% of CPU time.
+static int nice_weights[NICE_MAX - NICE_MIN + 1] = {
+	88761, 71755, 56483, 46273, 36291,
+	29154, 23254, 18705, 14949, 11916,
+	9548, 7620, 6100, 4904, 3906,
+	3121, 2501, 1991, 1586, 1277,
+	1024, 820, 655, 526, 423,
+	335, 272, 215, 172, 137,
+	110, 87, 70, 56, 45,
+	36, 29, 23, 18, 15,
+};
+#define NICE_0_WEIGHT 1024
+
+// Charge p for the CPU time it has used since it was
+// switched in or last charged, scaled by its weight.
+// p->lock must be held.
+static void
+update_vruntime(struct proc *p)
+{
+	uint64 now = r_time();
+
+	p->vruntime += (now - p->runstart) * NICE_0_WEIGHT / nice_weights[p->nice - NICE_MIN];
+	p->runstart = now;
+}
+
+// Make p's vruntime relative to c's min_vruntime,
+// keeping its lead or lag on the CPU it last queued on.
+// A process that has slept gets at most one tick of
+// credit, so it runs soon but can't hog the CPU.
+// c->rqlock must be held.
+static void
+runq_rebase(struct cpu *c, struct proc *p)
+{
+	long lag;
+
+	lag = p->vruntime - (p->rqcpu ? p->rqcpu->min_vruntime : c->min_vruntime);
+	if(lag < -TICKINTERVAL)
+		lag = -TICKINTERVAL;
+	if(lag < 0 && -lag > c->min_vruntime)
+		p->vruntime = 0;
+	else
+		p->vruntime = c->min_vruntime + lag;
+	p->rqcpu = c;
+}
+
+static int
+rq_rank(struct proc *p)
+{
+	return p ? p->rqrank : 0;
+}
+
+// Merge two leftist heaps ordered by vruntime.
+// Only right spines are followed, and they are
+// O(log n) long, which bounds the recursion.
+static struct proc*
+rq_merge(struct proc *a, struct proc *b)
+{
+	struct proc *t;
+
+	if(a == 0)
+		return b;
+	if(b == 0)
+		return a;
+	if(b->vruntime < a->vruntime){
+		t = a;
+		a = b;
+		b = t;
+	}
+	a->rqright = rq_merge(a->rqright, b);
+	if(rq_rank(a->rqleft) < rq_rank(a->rqright)){
+		t = a->rqleft;
+		a->rqleft = a->rqright;
+		a->rqright = t;
+	}
+	a->rqrank = rq_rank(a->rqright) + 1;
+	return a;
+}
+
+// Add p to c's run queue.
+static void
+runq_push(struct cpu *c, struct proc *p)
+{
+	acquire(&c->rqlock);
+	runq_rebase(c, p);
+	p->rqleft = 0;
+	p->rqright = 0;
+	p->rqrank = 1;
+	c->rqroot = rq_merge(c->rqroot, p);
+	c->nrunnable++;
+	release(&c->rqlock);
+}
+
+// Remove and return the process with the least
+// vruntime on c's run queue, or 0 if it is empty.
+static struct proc*
+runq_pop(struct cpu *c)
+{
+	struct proc *p;
+
+	acquire(&c->rqlock);
+	p = c->rqroot;
+	if(p){
+		c->rqroot = rq_merge(p->rqleft, p->rqright);
+		p->rqleft = 0;
+		p->rqright = 0;
+		c->nrunnable--;
+		if(p->vruntime > c->min_vruntime)
+			c->min_vruntime = p->vruntime;
+	}
+	release(&c->rqlock);
+	return p;
+}
+
+// Take a process from the longest run queue
+// of the other CPUs, or return 0 if they are all empty.
+// nrunnable is read without the queue locks, so this
+// is only a hint; runq_pop() rechecks under the lock.
+static struct proc*
+runq_steal(struct cpu *c)
+{
+	struct proc *p;
+	struct cpu *victim, *o;
+	int most;
+
+	victim = 0;
+	most = 0;
+	for(o = cpus; o < &cpus[NCPU]; o++){
+		if(o != c && o->nrunnable > most){
+			most = o->nrunnable;
+			victim = o;
+		}
+	}
+	if(victim == 0)
+		return 0;
+	if((p = runq_pop(victim)) == 0)
+		return 0;
+	acquire(&c->rqlock);
+	runq_rebase(c, p);
+	release(&c->rqlock);
+	return p;
+}
+
+// Is any run queue non-empty?
+static int
+anyrunnable(void)
+{
+	struct cpu *o;
+
+	for(o = cpus; o < &cpus[NCPU]; o++)
+		if(o->nrunnable > 0)
+			return 1;
+	return 0;
+}
+
+// Mark p RUNNABLE and queue it on this CPU's run queue.
+// If this CPU is busy with some other process, send a
+// wakeup IPI to an idle CPU so that it steals p.
+// p->lock must be held.
+static void
+setrunnable(struct proc *p)
+{
+	struct cpu *c = mycpu();
+	struct cpu *o;
+
+	p->state = RUNNABLE;
+	runq_push(c, p);
+	if(c->nrunnable < 2 && (c->proc == 0 || c->proc == p))
+		return;
+
+	// pairs with the barrier in idle(): either we see
+	// o->idle set, or o sees nrunnable go up.
+	__sync_synchronize();
+	for(o = cpus; o < &cpus[NCPU]; o++){
+		if(o != c && o->idle){
+			*(uint32*)CLINT_MSIP(o - cpus) = 1;
+			break;
+		}
+	}
+}
+
+// Park this CPU in wfi until an interrupt arrives: a
+// clock tick, a device, or a wakeup IPI from setrunnable().
+static void
+idle(struct cpu *c)
+{
+	uint64 start;
+
+	// with interrupts off, one that arrives between the
+	// check and wfi stays pending, and wfi returns at once.
+	intr_off();
+	c->idle = 1;
+	__sync_synchronize();
+	if(!anyrunnable()){
+		start = r_time();
+		asm volatile("wfi");
+		c->idletime += r_time() - start;
+	}
+	c->idle = 0;
+	intr_on();
+}
+
 int
 allocpid() {
 	int pid;
@@ -112,7 +469,73 @@ allocpid() {
 	return pid;
 }
 
-// Look in the process table for an UNUSED proc.
+static void
+pidhash_insert(struct proc *p)
+{
+	struct proc **b = &pidhash.bucket[p->pid % NPIDHASH];
+
+	acquire(&pidhash.lock);
+	p->pidnext = *b;
+	*b = p;
+	release(&pidhash.lock);
+}
+
+static void
+pidhash_remove(struct proc *p)
+{
+	struct proc **pp;
+
+	acquire(&pidhash.lock);
+	for(pp = &pidhash.bucket[p->pid % NPIDHASH]; *pp; pp = &(*pp)->pidnext){
+		if(*pp == p){
+			*pp = p->pidnext;
+			break;
+		}
+	}
+	p->pidnext = 0;
+	release(&pidhash.lock);
+}
+
+// Return the process with the given pid, or 0.
+// pidhash.lock must be held.
+static struct proc*
+pidhash_lookup(int pid)
+{
+	struct proc *p;
+
+	if(pid <= 0)
+		return 0;
+	for(p = pidhash.bucket[pid % NPIDHASH]; p; p = p->pidnext)
+		if(p->pid == pid)
+			return p;
+	return 0;
+}
+
+// Add p to the group p->pgid. pgrp.lock must be held.
+static void
+pgrp_link(struct proc *p)
+{
+	struct proc **b = &pgrp.bucket[p->pgid % NPIDHASH];
+
+	p->pgnext = *b;
+	if(*b)
+		(*b)->pgprev = &p->pgnext;
+	*b = p;
+	p->pgprev = b;
+}
+
+// Take p out of its group. pgrp.lock must be held.
+static void
+pgrp_unlink(struct proc *p)
+{
+	*p->pgprev = p->pgnext;
+	if(p->pgnext)
+		p->pgnext->pgprev = p->pgprev;
+	p->pgnext = 0;
+	p->pgprev = 0;
+}
+
+// Get an UNUSED proc from the process table.
 // If found, initialize state required to run in the kernel,
 // and return with p->lock held.
 // If there are no free procs, or a memory allocation fails, return 0.
@@ -121,19 +544,15 @@ allocproc(void)
 {
 	struct proc *p;
 
-	for(p = proc; p < &proc[NPROC]; p++) {
-		acquire(&p->lock);
-		if(p->state == UNUSED) {
-			goto found;
-		} else {
-			release(&p->lock);
-		}
-	}
-	return 0;
+	if((p = procget()) == 0)
+		return 0;
+	acquire(&p->lock);
+	if(p->state != UNUSED)
+		panic("allocproc");
 
-found:
 	p->pid = allocpid();
 	p->state = USED;
+	pidhash_insert(p);
 
 	// Allocate a trapframe page.
 	if((p->trapframe = (struct trapframe *)kalloc()) == 0){
@@ -142,6 +561,15 @@ found:
 		return 0;
 	}
 
+	// Allocate the page user space reads its pid from.
+	if((p->usyscall = (struct usyscall *)kalloc()) == 0){
+		freeproc(p);
+		release(&p->lock);
+		return 0;
+	}
+	memset(p->usyscall, 0, PGSIZE);
+	p->usyscall->pid = p->pid;
+
 	// An empty user page table.
 	p->pagetable = proc_pagetable(p);
 	if(p->pagetable == 0){
@@ -156,26 +584,13 @@ found:
 	p->context.ra = (uint64)forkret;
 	p->context.sp = p->kstack + PGSIZE;
 
-	// Allocate a backup trapframe page.
-	if((p->trapframe_backup = (struct trapframe *)kalloc()) == 0){
-		freeproc(p);
-		release(&p->lock);
-		return 0;
-	}
-	
 	for (int i = 0; i < SIGNALS_COUNT; i++){
-		if(i == SIG_DFL 
-		|| i == SIG_IGN 
-		|| i == SIGKILL 
-		|| i == SIGSTOP 
-		|| i == SIGCONT){
-			p->signal_handlers[i] = def_handlers[i];
-		}
-		else{
-			p->signal_handlers[i] = sigkill_handler;
-		}
+		p->signal_handlers[i] = sigdefault(i);
 		p->signal_handlers_masks[i] = 0;
 	}
+	p->itimer.fn = itimer_expired;
+	p->itimer.arg = p;
+	p->itinterval = 0;
 
 	return p;
 }
@@ -186,11 +601,16 @@ found:
 static void
 freeproc(struct proc *p)
 {
+	// unhash first, so kill() can no longer find p
+	// by the time its signal state is cleared below.
+	if(p->pid)
+		pidhash_remove(p);
 	if(p->trapframe)
 		kfree((void*)p->trapframe);
-	if(p->trapframe_backup)
-		kfree((void*)p->trapframe_backup);
 	p->trapframe = 0;
+	if(p->usyscall)
+		kfree((void*)p->usyscall);
+	p->usyscall = 0;
 	if(p->pagetable)
 		proc_freepagetable(p->pagetable, p->sz);
 	p->pagetable = 0;
@@ -201,9 +621,17 @@ freeproc(struct proc *p)
 	p->chan = 0;
 	p->killed = 0;
 	p->xstate = 0;
+	p->stopreport = 0;
 	p->state = UNUSED;
 	p->pending_signals = 0;
 	p->signal_mask = 0;
+	p->nsigq = 0;
+	p->ring = 0;
+	p->ringentries = 0;
+	p->nice = 0;
+	p->vruntime = 0;
+	p->rqcpu = 0;
+	procput(p);
 }
 // Create a user page table for a given process,
 // with no user memory, but with trampoline pages.
@@ -235,6 +663,38 @@ proc_pagetable(struct proc *p)
 		return 0;
 	}
 
+	// map the signal return code just below TRAPFRAME.
+	// user handlers return into it, so PTE_U; one physical
+	// page is shared by every process.
+	if(mappages(pagetable, SIGTRAMPOLINE, PGSIZE,
+							(uint64)sigtramp, PTE_R | PTE_X | PTE_U) < 0){
+		uvmunmap(pagetable, TRAMPOLINE, 1, 0);
+		uvmunmap(pagetable, TRAPFRAME, 1, 0);
+		uvmfree(pagetable, 0);
+		return 0;
+	}
+
+	// map the pages that ulib.c reads instead of making
+	// system calls: this process's below SIGTRAMPOLINE,
+	// and the one shared by all processes below that.
+	if(mappages(pagetable, USYSCALL, PGSIZE,
+							(uint64)(p->usyscall), PTE_R | PTE_U) < 0){
+		uvmunmap(pagetable, TRAMPOLINE, 1, 0);
+		uvmunmap(pagetable, TRAPFRAME, 1, 0);
+		uvmunmap(pagetable, SIGTRAMPOLINE, 1, 0);
+		uvmfree(pagetable, 0);
+		return 0;
+	}
+	if(mappages(pagetable, VDSO, PGSIZE,
+							(uint64)vdso, PTE_R | PTE_U) < 0){
+		uvmunmap(pagetable, TRAMPOLINE, 1, 0);
+		uvmunmap(pagetable, TRAPFRAME, 1, 0);
+		uvmunmap(pagetable, SIGTRAMPOLINE, 1, 0);
+		uvmunmap(pagetable, USYSCALL, 1, 0);
+		uvmfree(pagetable, 0);
+		return 0;
+	}
+
 	return pagetable;
 }
 
@@ -245,6 +705,9 @@ proc_freepagetable(pagetable_t pagetable, uint64 sz)
 {
 	uvmunmap(pagetable, TRAMPOLINE, 1, 0);
 	uvmunmap(pagetable, TRAPFRAME, 1, 0);
+	uvmunmap(pagetable, SIGTRAMPOLINE, 1, 0);
+	uvmunmap(pagetable, USYSCALL, 1, 0);
+	uvmunmap(pagetable, VDSO, 1, 0);
 	uvmfree(pagetable, sz);
 }
 
@@ -280,9 +743,17 @@ userinit(void)
 
 	safestrcpy(p->name, "initcode", sizeof(p->name));
 	p->cwd = namei("/");
+	p->pgid = p->pid;
+	release(&p->lock);
 
-	p->state = RUNNABLE;
+	// like fork(), link into the group without p->lock,
+	// which comes after pgrp.lock.
+	acquire(&pgrp.lock);
+	pgrp_link(p);
+	release(&pgrp.lock);
 
+	acquire(&p->lock);
+	setrunnable(p);
 	release(&p->lock);
 }
 
@@ -306,6 +777,30 @@ growproc(int n)
 	return 0;
 }
 
+// Push p onto a parent's children or zombies list.
+// wait_lock must be held.
+static void
+sibling_link(struct proc **head, struct proc *p)
+{
+	p->sibnext = *head;
+	if(*head)
+		(*head)->sibprev = &p->sibnext;
+	*head = p;
+	p->sibprev = head;
+}
+
+// Remove p from whichever sibling list it is on.
+// wait_lock must be held.
+static void
+sibling_unlink(struct proc *p)
+{
+	*p->sibprev = p->sibnext;
+	if(p->sibnext)
+		p->sibnext->sibprev = p->sibprev;
+	p->sibnext = 0;
+	p->sibprev = 0;
+}
+
 // Create a new process, copying the parent.
 // Sets up child kernel stack to return as if from fork() system call.
 int
@@ -343,6 +838,12 @@ fork(void)
 	safestrcpy(np->name, p->name, sizeof(p->name));
 
 	pid = np->pid;
+	np->nice = p->nice;
+	np->vruntime = p->vruntime;
+	np->rqcpu = p->rqcpu;
+	// the child's copy of memory has a copy of the ring.
+	np->ring = p->ring;
+	np->ringentries = p->ringentries;
 	np->signal_mask = p->signal_mask;
 	for (int i = 0; i < SIGNALS_COUNT; i++){
 		np->signal_handlers[i] = p->signal_handlers[i];
@@ -352,10 +853,15 @@ fork(void)
 
 	acquire(&wait_lock);
 	np->parent = p;
+	sibling_link(&p->children, np);
+	acquire(&pgrp.lock);
+	np->pgid = p->pgid;
+	pgrp_link(np);
+	release(&pgrp.lock);
 	release(&wait_lock);
 
 	acquire(&np->lock);
-	np->state = RUNNABLE;
+	setrunnable(np);
 	release(&np->lock);
 
 	return pid;
@@ -368,12 +874,19 @@ reparent(struct proc *p)
 {
 	struct proc *pp;
 
-	for(pp = proc; pp < &proc[NPROC]; pp++){
-		if(pp->parent == p){
-			pp->parent = initproc;
-			wakeup(initproc);
-		}
+	while((pp = p->children) != 0){
+		sibling_unlink(pp);
+		pp->parent = initproc;
+		sibling_link(&initproc->children, pp);
+	}
+	if(p->zombies == 0)
+		return;
+	while((pp = p->zombies) != 0){
+		sibling_unlink(pp);
+		pp->parent = initproc;
+		sibling_link(&initproc->zombies, pp);
 	}
+	wakeup(initproc);
 }
 
 uint 
@@ -389,18 +902,27 @@ sigprocmask(uint sigprocmask)
 }
 
 //int signum, const struct sigaction *act, struct sigaction *oldact
+// SIG_DFL and SIG_IGN in sa_handler stand for the kernel
+// handlers, which are never shown to user space.
 
 int
 sigaction(int signum, uint64 act_addr, uint64 old_act_addr)
 {	
-	if(signum > SIGNALS_COUNT || signum < 0){
+	if(signum >= SIGNALS_COUNT || signum < 0){
 		return -1;
 	}
 	struct proc *p = myproc();
 	struct sigaction old_act;
 	struct sigaction new_act;
+	handler *h;
 	acquire(&p->lock);
-	old_act.sa_handler = p->signal_handlers[signum];
+	h = p->signal_handlers[signum];
+	if(h == sigign_handler)
+		old_act.sa_handler = (handler*)SIG_IGN;
+	else if(sigkernel(h))
+		old_act.sa_handler = (handler*)SIG_DFL;
+	else
+		old_act.sa_handler = h;
 	old_act.sigmask = p->signal_handlers_masks[signum];
 	if(old_act_addr != 0){
 		if(copyout(p->pagetable, old_act_addr, (char *)&old_act, sizeof(old_act)) < 0){
@@ -408,35 +930,56 @@ sigaction(int signum, uint64 act_addr, uint64 old_act_addr)
 			return -1;
 		}
 	}
-	if(act_addr != 0){
-		if(signum == SIGKILL || signum == SIGSTOP){
-			release(&p->lock);
-			return -1;
-		}
-		if(copyin(p->pagetable, (char *)&new_act, act_addr, sizeof(new_act)) < 0){
-			release(&p->lock);
-			return -1;
-		}
+	if(act_addr == 0){
+		release(&p->lock);
+		return 0;
+	}
+	if(signum == SIGKILL || signum == SIGSTOP){
+		release(&p->lock);
+		return -1;
+	}
+	if(copyin(p->pagetable, (char *)&new_act, act_addr, sizeof(new_act)) < 0){
+		release(&p->lock);
+		return -1;
 	}
 	if(is_valid_sigmask(new_act.sigmask) < 0){
 		release(&p->lock);
 		return -1;
 	}
-	p->signal_handlers[signum] = new_act.sa_handler;
+	h = new_act.sa_handler;
+	if(h == (handler*)SIG_DFL)
+		h = sigdefault(signum);
+	else if(h == (handler*)SIG_IGN)
+		h = sigign_handler;
+	p->signal_handlers[signum] = h;
 	p->signal_handlers_masks[signum] = new_act.sigmask;
 	release(&p->lock);
 	return 0;
 }
 
-void
-sigret(){
+// Return from a user signal handler: restore the context
+// and signal mask that handle_user_signal() saved in the
+// struct sigframe at the handler's stack pointer.
+// A process whose frame is unreadable or corrupt is killed.
+// Returns 0, or -1 on a bad frame.
+int
+sigret(void)
+{
 	struct proc* p = myproc();
-	printf("in sig ret");
+	struct sigframe f;
+
+	klog(KLOG_TRACE, "pid %d: sigret\n", p->pid);
+	if(copyin(p->pagetable, (char *)&f, p->trapframe->sp, sizeof(f)) < 0
+	|| f.magic != SIGFRAME_MAGIC){
+		p->killed = 1;
+		return -1;
+	}
 	acquire(&p->lock);
-	*(p->trapframe) = *(p->trapframe_backup);
-	p->signal_mask = p->signal_mask_backup;
-	p->is_handling_signal = 0;
+	// usertrapret() rewrites the kernel_* fields anyway.
+	*(p->trapframe) = f.tf;
+	p->signal_mask = f.mask & ~(1 << SIGKILL | 1 << SIGSTOP);
 	release(&p->lock);
+	return 0;
 }
 
 int 
@@ -474,13 +1017,32 @@ exit(int status)
 	end_op();
 	p->cwd = 0;
 
+	// A zombie can be freed at any time, so its
+	// interval timer mustn't fire after this.
+	acquire(&tickslock);
+	timer_del(&p->itimer);
+	release(&tickslock);
+
 	acquire(&wait_lock);
 
 	// Give any children to init.
 	reparent(p);
 
-	// Parent might be sleeping in wait().
+	// Group signals are for live processes only. this is
+	// done under wait_lock so that setpgid() never finds
+	// p on the children list but out of its group.
+	acquire(&pgrp.lock);
+	pgrp_unlink(p);
+	release(&pgrp.lock);
+
+	// Move to the parent's zombies list, where wait() looks.
+	sibling_unlink(p);
+	sibling_link(&p->parent->zombies, p);
+
+	// Parent might be sleeping in wait(), or want to
+	// know without sleeping there.
 	wakeup(p->parent);
+	kill(p->parent->pid, SIGCHLD);
 	
 	acquire(&p->lock);
 
@@ -494,59 +1056,127 @@ exit(int status)
 	panic("zombie exit");
 }
 
+// Is pid a child of p, or is pid -1 and p has any
+// children? wait_lock must be held.
+static int
+haschild(struct proc *p, int pid)
+{
+	struct proc *np;
+
+	if(pid == -1)
+		return p->children != 0 || p->zombies != 0;
+	for(np = p->children; np; np = np->sibnext)
+		if(np->pid == pid)
+			return 1;
+	for(np = p->zombies; np; np = np->sibnext)
+		if(np->pid == pid)
+			return 1;
+	return 0;
+}
+
 // Wait for a child process to exit and return its pid.
 // Return -1 if this process has no children.
 int
 wait(uint64 addr)
+{
+	return waitpid(-1, addr, 0);
+}
+
+// Find a live child of p, pid or any if pid is -1, that
+// has stopped and not been reported, and mark it reported.
+// Returns it with its lock held, or 0.
+// wait_lock must be held.
+static struct proc*
+stoppedchild(struct proc *p, int pid)
+{
+	struct proc *np;
+
+	for(np = p->children; np; np = np->sibnext){
+		if(pid != -1 && np->pid != pid)
+			continue;
+		acquire(&np->lock);
+		if(np->state == STOPPED && np->stopreport){
+			np->stopreport = 0;
+			return np;
+		}
+		release(&np->lock);
+	}
+	return 0;
+}
+
+// Wait for child pid, or any child if pid is -1, to exit,
+// and return its pid. With WNOHANG, return 0 instead of
+// waiting if it hasn't exited yet. With WUNTRACED, also
+// return a child that has stopped since it was last
+// returned this way, with status WSTOPPED.
+// Return -1 if there is no such child.
+int
+waitpid(int pid, uint64 addr, int options)
 {
 	struct proc *np;
-	int havekids, pid;
 	struct proc *p = myproc();
+	int xstate;
 
 	acquire(&wait_lock);
 
 	for(;;){
-		// Scan through table looking for exited children.
-		havekids = 0;
-		for(np = proc; np < &proc[NPROC]; np++){
-			if(np->parent == p){
-				// make sure the child isn't still in exit() or swtch().
-				acquire(&np->lock);
-
-				havekids = 1;
-				if(np->state == ZOMBIE){
-					// Found one.
-					pid = np->pid;
-					if(addr != 0 && copyout(p->pagetable, addr, (char *)&np->xstate,
-																	sizeof(np->xstate)) < 0) {
-						release(&np->lock);
-						release(&wait_lock);
-						return -1;
-					}
-					freeproc(np);
-					release(&np->lock);
-					release(&wait_lock);
-					return pid;
-				}
+		// a zombie's pid can't change while wait_lock is held.
+		for(np = p->zombies; np && pid != -1 && np->pid != pid; np = np->sibnext)
+			;
+		if(np != 0){
+			pid = np->pid;
+			// make sure the child isn't still in exit() or swtch().
+			acquire(&np->lock);
+			if(np->state != ZOMBIE)
+				panic("wait: not zombie");
+			if(addr != 0 && copyout(p->pagetable, addr, (char *)&np->xstate,
+															sizeof(np->xstate)) < 0) {
 				release(&np->lock);
+				release(&wait_lock);
+				return -1;
 			}
+			sibling_unlink(np);
+			freeproc(np);
+			release(&np->lock);
+			release(&wait_lock);
+			return pid;
+		}
+
+		if((options & WUNTRACED) && (np = stoppedchild(p, pid)) != 0){
+			pid = np->pid;
+			release(&np->lock);
+			release(&wait_lock);
+			xstate = WSTOPPED;
+			if(addr != 0 && copyout(p->pagetable, addr, (char *)&xstate,
+															sizeof(xstate)) < 0)
+				return -1;
+			return pid;
 		}
 
 		// No point waiting if we don't have any children.
-		if(!havekids || p->killed){
+		if(!haschild(p, pid)){
+			release(&wait_lock);
+			return -1;
+		}
+		if(options & WNOHANG){
+			release(&wait_lock);
+			return 0;
+		}
+		if(signal_pending(p)){
 			release(&wait_lock);
 			return -1;
 		}
 		
 		// Wait for a child to exit.
-		sleep(p, &wait_lock);  //DOC: wait-sleep
+		sleep_intr(p, &wait_lock);  //DOC: wait-sleep
 	}
 }
 
 // Per-CPU process scheduler.
 // Each CPU calls scheduler() after setting itself up.
 // Scheduler never returns.  It loops, doing:
-//  - choose a process to run.
+//  - take the process with the least vruntime from this
+//    CPU's run queue, or steal one from another CPU's.
 //  - swtch to start running that process.
 //  - eventually that process transfers control
 //    via swtch back to the scheduler.
@@ -561,30 +1191,38 @@ scheduler(void)
 		// Avoid deadlock by ensuring that devices can interrupt.
 		intr_on();
 
-		for(p = proc; p < &proc[NPROC]; p++) {
-			acquire(&p->lock);
-			if(p->state == RUNNABLE) {
-				// Switch to chosen process.  It is the process's job
-				// to release its lock and then reacquire it
-				// before jumping back to us.
-				if(p->is_stopped){
-					int is_blocked = (1 << SIGCONT & p->signal_mask);
-					int is_set = (1 << SIGCONT & p->pending_signals);
-					if(is_blocked || !is_set){
-						release(&p->lock);
-						continue;
-					}
-				}
-				p->state = RUNNING;
-				c->proc = p;
-				swtch(&c->context, &p->context);
-
-				// Process is done running for now.
-				// It should have changed its p->state before coming back.
-				c->proc = 0;
-			}
-			release(&p->lock);
+		if((p = runq_pop(c)) == 0 && (p = runq_steal(c)) == 0){
+			idle(c);
+			continue;
+		}
+
+		// p came off a run queue, so nobody else will try
+		// to run it; but the CPU that queued it may still
+		// hold p->lock on its way into sched().
+		acquire(&p->lock);
+		if(p->state != RUNNABLE)
+			panic("scheduler: queued proc not runnable");
+
+		// Another CPU may have mapped p's kernel stack
+		// since this CPU last flushed its TLB.
+		if(c->stackgen != ptable.stackgen){
+			c->stackgen = ptable.stackgen;
+			sfence_vma();
 		}
+
+		// Switch to chosen process.  It is the process's job
+		// to release its lock and then reacquire it
+		// before jumping back to us.
+		p->state = RUNNING;
+		p->runstart = r_time();
+		c->proc = p;
+		trace(TR_SWITCH, p->pid, 0);
+		swtch(&c->context, &p->context);
+
+		// Process is done running for now.
+		// It should have changed its p->state before coming back.
+		c->proc = 0;
+		release(&p->lock);
 	}
 }
 
@@ -610,6 +1248,11 @@ sched(void)
 	if(intr_get())
 		panic("sched interruptible");
 
+	// yield() has charged p already, before queueing it.
+	if(p->state != RUNNABLE)
+		update_vruntime(p);
+
+	trace(TR_SCHED, p->state, 0);
 	intena = mycpu()->intena;
 	swtch(&p->context, &mycpu()->context);
 	mycpu()->intena = intena;
@@ -622,7 +1265,8 @@ yield(void)
 {
 	struct proc *p = myproc();
 	acquire(&p->lock);
-	p->state = RUNNABLE;
+	update_vruntime(p);
+	setrunnable(p);
 	sched();
 	release(&p->lock);
 }
@@ -648,75 +1292,532 @@ forkret(void)
 	usertrapret();
 }
 
-// Atomically release lock and sleep on chan.
-// Reacquires lock when awakened.
-void
-sleep(void *chan, struct spinlock *lk)
+// Return the sleep queue bucket for chan.
+static struct sleepq*
+sleepq_for(void *chan)
+{
+	uint64 h = (uint64)chan;
+
+	return &sleepq[(h ^ (h >> 12)) % NSLEEPQ];
+}
+
+// Take p off sq's list. sq->lock must be held.
+static void
+sleepq_remove(struct sleepq *sq, struct proc *p)
+{
+	struct proc **pp;
+
+	for(pp = &sq->head; *pp; pp = &(*pp)->sqnext){
+		if(*pp == p){
+			*pp = p->sqnext;
+			p->sqnext = 0;
+			return;
+		}
+	}
+	panic("sleepq_remove");
+}
+
+static void
+sleep1(void *chan, struct spinlock *lk, int interruptible)
 {
 	struct proc *p = myproc();
+	struct sleepq *sq = sleepq_for(chan);
 	
 	// Must acquire p->lock in order to
 	// change p->state and then call sched.
-	// Once we hold p->lock, we can be
+	// Once we hold the bucket's lock, we can be
 	// guaranteed that we won't miss any wakeup
-	// (wakeup locks p->lock),
+	// (wakeup locks the bucket before looking at it),
 	// so it's okay to release lk.
 
+	acquire(&sq->lock);
 	acquire(&p->lock);  //DOC: sleeplock1
 	release(lk);
 
+	// kill() posts a signal before it takes p->lock to
+	// look for interruptible sleepers, so a signal that
+	// arrived after the caller last checked shows up here.
+	if(interruptible && signal_pending(p)){
+		release(&sq->lock);
+		release(&p->lock);
+		acquire(lk);
+		return;
+	}
+
 	// Go to sleep.
 	p->chan = chan;
+	p->interruptible = interruptible;
 	p->state = SLEEPING;
+	p->sqnext = sq->head;
+	sq->head = p;
+	release(&sq->lock);
 
+	trace(TR_SLEEP, (uint64)chan, 0);
 	sched();
 
 	// Tidy up.
 	p->chan = 0;
+	p->interruptible = 0;
 
 	// Reacquire original lock.
 	release(&p->lock);
 	acquire(lk);
 }
 
+// Atomically release lock and sleep on chan.
+// Reacquires lock when awakened.
+void
+sleep(void *chan, struct spinlock *lk)
+{
+	sleep1(chan, lk, 0);
+}
+
+// Like sleep(), but a signal that should interrupt
+// the caller (see signal_pending()) also ends the sleep,
+// or prevents it. Callers must check signal_pending()
+// after it returns.
+void
+sleep_intr(void *chan, struct spinlock *lk)
+{
+	sleep1(chan, lk, 1);
+}
+
 // Wake up all processes sleeping on chan.
 // Must be called without any p->lock.
 void
 wakeup(void *chan)
+{
+	struct sleepq *sq = sleepq_for(chan);
+	struct proc *p, **pp;
+
+	acquire(&sq->lock);
+	pp = &sq->head;
+	while((p = *pp) != 0){
+		// p->chan can't change while p is in the bucket.
+		if(p->chan != chan){
+			pp = &p->sqnext;
+			continue;
+		}
+		*pp = p->sqnext;
+		p->sqnext = 0;
+		acquire(&p->lock);
+		if(p->state != SLEEPING)
+			panic("wakeup");
+		trace(TR_WAKEUP, p->pid, (uint64)chan);
+		setrunnable(p);
+		release(&p->lock);
+	}
+	release(&sq->lock);
+}
+
+// Would signum, delivered to p, do more than stop it,
+// continue it, or be ignored? Such signals end an
+// interruptible sleep, as do the ones sigtake() is
+// waiting for, blocked or not.
+static int
+signal_interrupts(struct proc *p, int signum)
+{
+	void *h = p->signal_handlers[signum];
+
+	if(signum == SIGKILL || (p->sigwait_mask & (1 << signum)))
+		return 1;
+	if(p->signal_mask & (1 << signum))
+		return 0;
+	return h != sigign_handler && h != sigstop_handler && h != sigcont_handler;
+}
+
+// Return 1 if p has been killed or has a pending signal
+// that should cut a sleep_intr() short.
+int
+signal_pending(struct proc *p)
+{
+	uint pending = p->pending_signals;
+
+	if(p->killed)
+		return 1;
+	for(int i = 0; pending; i++, pending >>= 1)
+		if((pending & 1) && signal_interrupts(p, i))
+			return 1;
+	return 0;
+}
+
+// Make p notice a signal that was just posted to it:
+// SIGCONT and SIGKILL make a STOPPED p runnable, and a
+// signal that interrupts makes an interruptible sleeper
+// runnable. The bit is set before p->lock is taken, so
+// a p that is about to stop or sleep sees it instead
+// (see sigstop_handler() and sleep1()).
+// p may have been freed and reused since the caller
+// found it, hence the pid checks.
+static void
+signal_wake(struct proc *p, int pid, int signum)
+{
+	struct sleepq *sq;
+	void *chan;
+
+	acquire(&p->lock);
+	if(p->pid != pid){
+		release(&p->lock);
+		return;
+	}
+	if(p->state == STOPPED && (signum == SIGCONT || signum == SIGKILL)){
+		p->stopreport = 0;
+		setrunnable(p);
+	}
+	if(p->state != SLEEPING || !p->interruptible || !signal_interrupts(p, signum)){
+		release(&p->lock);
+		return;
+	}
+	chan = p->chan;
+	release(&p->lock);
+
+	// a bucket's lock must be acquired before p->lock.
+	sq = sleepq_for(chan);
+	acquire(&sq->lock);
+	acquire(&p->lock);
+	if(p->pid == pid && p->state == SLEEPING && p->interruptible && p->chan == chan){
+		sleepq_remove(sq, p);
+		trace(TR_WAKEUP, p->pid, (uint64)chan);
+		setrunnable(p);
+	}
+	release(&p->lock);
+	release(&sq->lock);
+}
+
+// Mark signum pending for p.
+// pending_signals is updated with an atomic OR, so
+// no p->lock is needed for ordinary signals.
+static void
+signal_post(struct proc *p, int signum)
+{
+	// a stop discards a pending continue, and vice versa.
+	if(signum == SIGSTOP)
+		__sync_fetch_and_and(&p->pending_signals, ~(1 << SIGCONT));
+	else if(signum == SIGCONT)
+		__sync_fetch_and_and(&p->pending_signals, ~(1 << SIGSTOP));
+	__sync_fetch_and_or(&p->pending_signals, 1 << signum);
+	trace(TR_SIGPOST, p->pid, signum);
+}
+
+// Send signum to every member of process group pgid,
+// in a single pass over its pgrp bucket. init is never
+// signalled this way; everything inherits its group.
+static int
+killpg(int pgid, int signum)
 {
 	struct proc *p;
+	int found = 0;
 
-	for(p = proc; p < &proc[NPROC]; p++) {
-		if(p != myproc()){
-			acquire(&p->lock);
-			if(p->state == SLEEPING && p->chan == chan) {
-				p->state = RUNNABLE;
-			}
-			release(&p->lock);
-		}
+	if(pgid <= 0)
+		return -1;
+	acquire(&pgrp.lock);
+	for(p = pgrp.bucket[pgid % NPIDHASH]; p; p = p->pgnext){
+		if(p->pgid != pgid || p == initproc)
+			continue;
+		signal_post(p, signum);
+		signal_wake(p, p->pid, signum);
+		found = 1;
 	}
+	release(&pgrp.lock);
+	return found ? 0 : -1;
 }
 
-// Kill the process with the given pid.
-// The victim won't exit until it tries to return
-// to user space (see usertrap() in trap.c).
+// Send signal signum to the process with the given pid,
+// or to every process in group -pid if pid is negative,
+// or in the caller's group if pid is 0.
+// The victim won't act on it until it tries to return
+// to user space (see usertrapret() in trap.c), except
+// that SIGCONT and SIGKILL make a STOPPED victim
+// runnable again right away.
 int
 kill(int pid, int signum)
 {
-	if (signum < 0 || signum > SIGNALS_COUNT){
+	struct proc *p;
+
+	if (signum < 0 || signum >= SIGNALS_COUNT){
+		return -1;
+	}
+	if(pid == 0)
+		return killpg(getpgid(0), signum);
+	// the most negative pid has no positive -pid.
+	if(pid < 0)
+		return (uint)pid == 0x80000000 ? -1 : killpg(-pid, signum);
+	acquire(&pidhash.lock);
+	if((p = pidhash_lookup(pid)) == 0){
+		release(&pidhash.lock);
+		return -1;
+	}
+	signal_post(p, signum);
+	release(&pidhash.lock);
+
+	signal_wake(p, pid, signum);
+	return 0;
+}
+
+// Is there a process in group pgid? pgrp.lock must be held.
+static int
+pgrp_exists(int pgid)
+{
+	struct proc *p;
+
+	for(p = pgrp.bucket[pgid % NPIDHASH]; p; p = p->pgnext)
+		if(p->pgid == pgid)
+			return 1;
+	return 0;
+}
+
+// Put process pid, which must be the caller or one of its
+// children, into group pgid, which must be pid itself or
+// a group that already exists. pid 0 means the caller,
+// and pgid 0 means a new group whose pgid is pid.
+// Returns 0, or -1 if pid isn't the caller or a child,
+// or pgid isn't allowed.
+int
+setpgid(int pid, int pgid)
+{
+	struct proc *p = myproc();
+	struct proc *np;
+
+	if(pgid < 0)
 		return -1;
+	acquire(&wait_lock);
+	if(pid == 0 || pid == p->pid){
+		np = p;
+	} else {
+		for(np = p->children; np && np->pid != pid; np = np->sibnext)
+			;
+		if(np == 0){
+			release(&wait_lock);
+			return -1;
+		}
 	}
+	if(pgid == 0)
+		pgid = np->pid;
+	acquire(&pgrp.lock);
+	if(pgid != np->pid && !pgrp_exists(pgid)){
+		release(&pgrp.lock);
+		release(&wait_lock);
+		return -1;
+	}
+	pgrp_unlink(np);
+	np->pgid = pgid;
+	pgrp_link(np);
+	release(&pgrp.lock);
+	release(&wait_lock);
+	return 0;
+}
+
+// Return the process group of process pid, or of the
+// caller if pid is 0; -1 if there is no such process.
+int
+getpgid(int pid)
+{
 	struct proc *p;
-	for(p = proc; p < &proc[NPROC]; p++){
-		acquire(&p->lock);
-		if(p->pid == pid){
-			p->pending_signals = 1 << signum | p -> pending_signals;
-			release(&p->lock);
-			return 0;
+	int pgid = -1;
+
+	if(pid == 0)
+		pid = myproc()->pid;
+	acquire(&pidhash.lock);
+	if((p = pidhash_lookup(pid)) != 0){
+		acquire(&pgrp.lock);
+		pgid = p->pgid;
+		release(&pgrp.lock);
+	}
+	release(&pidhash.lock);
+	return pgid;
+}
+
+// Like kill(), but also queue value for signum's handler,
+// so that every send is delivered, with its own value,
+// rather than collapsing into one pending bit. The queue
+// is a fixed array in the proc, so nothing is allocated.
+// The kernel's own SIGKILL, SIGSTOP and SIGCONT don't
+// queue. Returns -1 if p's queue is full.
+int
+sigqueue(int pid, int signum, uint64 value)
+{
+	struct proc *p;
+
+	if(signum < 0 || signum >= SIGNALS_COUNT)
+		return -1;
+	if(signum == SIGKILL || signum == SIGSTOP || signum == SIGCONT)
+		return kill(pid, signum);
+
+	acquire(&pidhash.lock);
+	p = pidhash_lookup(pid);
+	release(&pidhash.lock);
+	if(p == 0)
+		return -1;
+
+	// p may have been freed and reused meanwhile.
+	acquire(&p->lock);
+	if(p->pid != pid || p->nsigq == NSIGQUEUE){
+		release(&p->lock);
+		return -1;
+	}
+	p->sigqsignum[p->nsigq] = signum;
+	p->sigqvalue[p->nsigq] = value;
+	p->nsigq++;
+	signal_post(p, signum);
+	release(&p->lock);
+
+	signal_wake(p, pid, signum);
+	return 0;
+}
+
+// Take the oldest value queued for signum off p's queue,
+// as signum is delivered; 0 if signum came from kill().
+// signum stays pending while more sends are queued.
+uint64
+sigdequeue(struct proc *p, int signum)
+{
+	uint64 value = 0;
+	int i;
+
+	acquire(&p->lock);
+	for(i = 0; i < p->nsigq && p->sigqsignum[i] != signum; i++)
+		;
+	if(i < p->nsigq){
+		value = p->sigqvalue[i];
+		p->nsigq--;
+		memmove(&p->sigqsignum[i], &p->sigqsignum[i+1], p->nsigq - i);
+		memmove(&p->sigqvalue[i], &p->sigqvalue[i+1], (p->nsigq - i) * sizeof(uint64));
+		for(; i < p->nsigq; i++){
+			if(p->sigqsignum[i] == signum){
+				__sync_fetch_and_or(&p->pending_signals, 1 << signum);
+				break;
+			}
 		}
+	}
+	release(&p->lock);
+	return value;
+}
+
+// clockintr() calls this, with tickslock held, when a
+// process's interval timer runs out. p can't have been
+// freed: exit() disarms the timer first.
+static void
+itimer_expired(struct timer *t)
+{
+	struct proc *p = t->arg;
+
+	if(p->itinterval)
+		timer_add(t, ticks + p->itinterval);
+	signal_post(p, SIGALRM);
+	signal_wake(p, p->pid, SIGALRM);
+}
+
+// Post SIGALRM to the caller value clock ticks from now,
+// and then every interval ticks if interval isn't 0.
+// value 0 disarms the timer. Returns the number of ticks
+// that were left before the old setting would have fired.
+int
+setitimer(uint value, uint interval)
+{
+	struct proc *p = myproc();
+	int left = 0;
+
+	acquire(&tickslock);
+	if(timer_pending(&p->itimer)){
+		left = p->itimer.expires - ticks;
+		timer_del(&p->itimer);
+	}
+	p->itinterval = interval;
+	if(value > 0)
+		timer_add(&p->itimer, ticks + value);
+	release(&tickslock);
+	return left;
+}
+
+// Take a pending signal in mask off the caller's pending
+// set without running its handler, and return its number,
+// with its sigqueue() value in *value. If none is pending
+// and block is set, wait for one. Returns -1 if there is
+// none, or if the caller is killed or another signal needs
+// delivering first. SIGKILL and SIGSTOP can't be taken.
+int
+sigtake(uint mask, uint64 *value, int block)
+{
+	struct proc *p = myproc();
+	uint ready;
+	int signum;
+
+	mask &= ~(1 << SIGKILL | 1 << SIGSTOP);
+	// kill() only reads sigwait_mask under p->lock, which
+	// sleep_intr() takes before its last look at
+	// pending_signals, so a send can't slip in between.
+	p->sigwait_mask = mask;
+	acquire(&sigwait_lock);
+	while((ready = p->pending_signals & mask) == 0){
+		if(!block || signal_pending(p)){
+			release(&sigwait_lock);
+			p->sigwait_mask = 0;
+			return -1;
+		}
+		sleep_intr(&p->sigwait_mask, &sigwait_lock);
+	}
+	release(&sigwait_lock);
+	p->sigwait_mask = 0;
+
+	for(signum = 0; (ready & (1 << signum)) == 0; signum++)
+		;
+	__sync_fetch_and_and(&p->pending_signals, ~(1 << signum));
+	*value = sigdequeue(p, signum);
+	return signum;
+}
+
+// read() on a signalfd: take pending signals in mask
+// as an array of struct siginfo, waiting for the first.
+int
+sigfdread(uint mask, uint64 addr, int n)
+{
+	struct proc *p = myproc();
+	struct siginfo si;
+	int i;
+
+	for(i = 0; i + sizeof(si) <= n; i += sizeof(si)){
+		if((si.signum = sigtake(mask, &si.value, i == 0)) < 0)
+			break;
+		if(copyout(p->pagetable, addr + i, (char *)&si, sizeof(si)) < 0)
+			break;
+	}
+	if(i == 0)
+		return -1;
+	return i;
+}
+
+// Set the nice value of the process with the given pid,
+// or of the caller if pid is 0, clamped to
+// NICE_MIN..NICE_MAX. It takes effect as the process
+// is charged for CPU time.
+// Returns 0, or -1 if there is no such process.
+int
+setnice(int pid, int nice)
+{
+	struct proc *p;
+
+	if(nice < NICE_MIN)
+		nice = NICE_MIN;
+	if(nice > NICE_MAX)
+		nice = NICE_MAX;
+
+	if(pid == 0)
+		pid = myproc()->pid;
+	acquire(&pidhash.lock);
+	p = pidhash_lookup(pid);
+	release(&pidhash.lock);
+	if(p == 0)
+		return -1;
+
+	// p may have been freed and reused meanwhile.
+	acquire(&p->lock);
+	if(p->pid != pid){
 		release(&p->lock);
+		return -1;
 	}
-	return -1;
+	p->nice = nice;
+	release(&p->lock);
+	return 0;
 }
 
 // Copy to either a user address, or kernel address,
@@ -760,15 +1861,20 @@ procdump(void)
 	[SLEEPING]  "sleep ",
 	[RUNNABLE]  "runble",
 	[RUNNING]   "run   ",
+	[STOPPED]   "stop  ",
 	[ZOMBIE]    "zombie"
 	};
 	struct proc *p;
+	struct cpu *c;
 	char *state;
 
 	printf("\n");
-	for(p = proc; p < &proc[NPROC]; p++){
-		if(p->state == UNUSED)
-			continue;
+	for(c = cpus; c < &cpus[NCPU]; c++){
+		if(c->idletime)
+			printf("cpu %d idle %d ms\n", (int)(c - cpus),
+			       (int)(c->idletime / (MTIME_FREQ / 1000)));
+	}
+	for(p = ptable.all; p; p = p->allnext){
 		if(p->state >= 0 && p->state < NELEM(states) && states[p->state])
 			state = states[p->state];
 		else
@@ -783,26 +1889,39 @@ sigkill_handler(int signum)
 {
 	struct proc* p = myproc();
 	p->killed = 1;
-	if (p->state == SLEEPING) {
-		// Wake process from sleep().
-		p->state = RUNNABLE;
-	}
 }
 
 void
 sigstop_handler(int signum)
 {
-	printf("in sig stop\n");
 	struct proc* p = myproc();
-	p->is_stopped = 1;
+
+	klog(KLOG_TRACE, "pid %d: stop\n", p->pid);
+
+	// a parent in waitpid(WUNTRACED) can't look at p again
+	// before p->lock is released in sched(), or go back to
+	// sleep without wait_lock, so it is safe to wake it
+	// before p is STOPPED.
+	acquire(&wait_lock);
+	wakeup(p->parent);
+
+	// stay off the run queues until kill() sees a
+	// SIGCONT or SIGKILL and makes p runnable again.
+	acquire(&p->lock);
+	release(&wait_lock);
+	if((p->pending_signals & (1 << SIGCONT | 1 << SIGKILL)) == 0){
+		p->state = STOPPED;
+		p->stopreport = 1;
+		sched();
+	}
+	release(&p->lock);
 }
 
 void
 sigcont_handler(int signum)
 {
-	printf("in sig cont\n");
-	struct proc* p = myproc();
-	p->is_stopped = 0;
+	// kill() has already made p runnable.
+	klog(KLOG_TRACE, "pid %d: continue\n", myproc()->pid);
 }
 
 void
@@ -1,4 +1,5 @@
 #include "signals.h"
+#include "timer.h"
 
 // Saved registers for kernel context switches.
 struct context {
@@ -32,6 +33,16 @@ struct cpu {
   struct context context;     // swtch() here to enter scheduler().
   int noff;                   // Depth of push_off() nesting.
   int intena;                 // Were interrupts enabled before push_off()?
+  int stackgen;               // ptable.stackgen last seen by this CPU's TLB
+  int idle;                   // Parked in wfi, or about to be
+  uint64 idletime;            // time CSR cycles spent parked
+
+  // run queue of RUNNABLE processes waiting for this CPU,
+  // a leftist heap ordered by vruntime.
+  struct spinlock rqlock;     // protects the fields below
+  struct proc *rqroot;        // process with the least vruntime
+  int nrunnable;              // number of processes in the heap
+  uint64 min_vruntime;        // vruntime of the last process taken
 };
 
 extern struct cpu cpus[NCPU];
@@ -87,7 +98,16 @@ struct trapframe {
   /* 280 */ uint64 t6;
 };
 
-enum procstate { UNUSED, USED, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
+// Saved on the user stack by handle_user_signal() while a
+// handler runs, and restored from there by sigret().
+struct sigframe {
+  struct trapframe tf;         // the interrupted user context
+  uint mask;                   // signal_mask to go back to
+  uint magic;                  // SIGFRAME_MAGIC, checked by sigret()
+};
+#define SIGFRAME_MAGIC 0x5167f4a3
+
+enum procstate { UNUSED, USED, SLEEPING, RUNNABLE, RUNNING, STOPPED, ZOMBIE };
 
 // Per-process state
 struct proc {
@@ -96,18 +116,52 @@ struct proc {
   // p->lock must be held when using these:
   enum procstate state;        // Process state
   void *chan;                  // If non-zero, sleeping on chan
+  int interruptible;           // If non-zero, kill() may end the sleep
   int killed;                  // If non-zero, have been killed
   int xstate;                  // Exit status to be returned to parent's wait
+  int stopreport;              // Stopped, and waitpid() hasn't said so yet
   int pid;                     // Process ID
 
-  // proc_tree_lock must be held when using this:
+  // the owning cpu's rqlock must be held when using these:
+  struct proc *rqleft;         // Run queue heap children
+  struct proc *rqright;
+  int rqrank;                  // Length of the heap's right spine from here
+  struct cpu *rqcpu;           // CPU whose min_vruntime vruntime is relative to
+  uint64 vruntime;             // Weighted CPU time used; least runs first
+
+  int nice;                    // -20 (largest CPU share) to 19; p->lock
+  uint64 runstart;             // When last switched in or charged
+
+  // the lock of chan's sleep queue must be held when using this:
+  struct proc *sqnext;         // Next process sleeping in the same bucket
+
+  // pidhash.lock must be held when using this:
+  struct proc *pidnext;        // Next process in the same pid hash bucket
+
+  // pgrp.lock must be held when using these:
+  int pgid;                    // Process group ID
+  struct proc *pgnext;         // Next process in the same pgrp hash bucket
+  struct proc **pgprev;        // Pointer to this proc in that bucket
+
+  // ptable.lock must be held when using these:
+  struct proc *allnext;        // Next live process, or next free proc
+  struct proc **allprev;       // Pointer to this proc in the live list
+
+  // wait_lock must be held when using these:
   struct proc *parent;         // Parent process
+  struct proc *children;       // Live children
+  struct proc *zombies;        // Exited children not yet waited for
+  struct proc *sibnext;        // Next on parent's children or zombies
+  struct proc **sibprev;       // Pointer to this proc in that list
 
   // these are private to the process, so p->lock need not be held.
   uint64 kstack;               // Virtual address of kernel stack
   uint64 sz;                   // Size of process memory (bytes)
   pagetable_t pagetable;       // User page table
   struct trapframe *trapframe; // data page for trampoline.S
+  struct usyscall *usyscall;   // data page mapped read-only at USYSCALL
+  uint64 ring;                 // user address of struct ring, or 0
+  uint ringentries;            // its entries, as of ring_setup()
   struct context context;      // swtch() here to run process
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
@@ -116,8 +170,17 @@ struct proc {
   uint signal_mask;
   void* signal_handlers[SIGNALS_COUNT];
   int signal_handlers_masks[SIGNALS_COUNT];
-  struct trapframe* trapframe_backup;
-  int signal_mask_backup;
-  char is_stopped;
-  char is_handling_signal;
+
+  // p->lock must be held to use these:
+  // sigqueue() sends, oldest first; kept as two arrays
+  // rather than an array of padded structs, so that
+  // three procs fit in a page.
+  uint64 sigqvalue[NSIGQUEUE];
+  uchar sigqsignum[NSIGQUEUE];
+  int nsigq;                   // entries in use in sigq*
+  uint sigwait_mask;           // signals sigtake() is sleeping for
+
+  // tickslock must be held to use these:
+  struct timer itimer;         // posts SIGALRM, see setitimer()
+  uint itinterval;             // ticks to rearm itimer with, or 0
 };
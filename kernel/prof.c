@@ -0,0 +1,166 @@
+//
+// timer-driven sampling profiler.
+//
+// while it is on, every prof_period'th timer interrupt
+// on each CPU records the interrupted pc and a call chain
+// found by following saved frame pointers (the kernel and
+// user programs are built with -fno-omit-frame-pointer).
+// samples go into a per-CPU buffer, from which prof()
+// moves them out to user space; user/profsym.pl turns
+// the pcs back into names using the .sym files.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "prof.h"
+#include "klog.h"
+#include "defs.h"
+
+static int prof_period;  // ticks between samples; 0 if off
+
+static struct profbuf {
+  struct spinlock lock;  // contended only by prof()
+  int countdown;         // ticks until the next sample
+  int n;                 // samples in buf
+  int lost;              // samples dropped since buf was full
+  struct profsample buf[NPROFSAMPLE];
+} profbuf[NCPU];
+
+void
+profinit(void)
+{
+  for(int i = 0; i < NCPU; i++)
+    initlock(&profbuf[i].lock, "prof");
+}
+
+// follow kernel frame pointers, without leaving the
+// page of stack that fp starts in. the outermost frame
+// may hold a user's s0, or 0, so check every fp before
+// using it, and each frame must be above the last.
+static int
+kwalk(uint64 fp, uint64 *pc, int n)
+{
+  uint64 lo, hi, next;
+  int i;
+
+  if(fp < 16)
+    return 0;
+  lo = PGROUNDDOWN(fp - 16);
+  hi = lo + PGSIZE;
+  for(i = 0; i < n && fp % 8 == 0 && fp >= lo + 16 && fp <= hi; i++){
+    pc[i] = *(uint64*)(fp - 8);
+    next = *(uint64*)(fp - 16);
+    if(next <= fp)
+      return i + 1;
+    fp = next;
+  }
+  return i;
+}
+
+// follow user frame pointers. stacks grow down, so each
+// frame must be above the last.
+static int
+uwalk(struct proc *p, uint64 fp, uint64 *pc, int n)
+{
+  uint64 frame[2];  // saved fp, then ra
+  int i;
+
+  for(i = 0; i < n && fp % 8 == 0; i++){
+    if(copyin(p->pagetable, (char *)frame, fp - 16, sizeof(frame)) < 0)
+      break;
+    pc[i] = frame[1];
+    if(frame[0] <= fp)
+      return i + 1;
+    fp = frame[0];
+  }
+  return i;
+}
+
+// Called on each CPU's timer interrupt with the pc and
+// frame pointer of the code it interrupted, which was
+// the current process's user code if user is set.
+// interrupts must be off.
+void
+prof_tick(int user, uint64 pc, uint64 fp)
+{
+  struct profbuf *b;
+  struct profsample *s;
+  struct proc *p;
+
+  if(prof_period == 0)
+    return;
+  b = &profbuf[cpuid()];
+  if(--b->countdown > 0)
+    return;
+  b->countdown = prof_period;
+
+  p = myproc();
+  acquire(&b->lock);
+  if(b->n == NPROFSAMPLE){
+    b->lost++;
+    release(&b->lock);
+    return;
+  }
+  s = &b->buf[b->n++];
+  s->cpu = cpuid();
+  s->pid = p ? p->pid : 0;
+  s->user = user;
+  if(p)
+    safestrcpy(s->name, p->name, sizeof(s->name));
+  else
+    safestrcpy(s->name, "-", sizeof(s->name));
+  s->pc[0] = pc;
+  if(user)
+    s->depth = 1 + uwalk(p, fp, s->pc + 1, PROF_DEPTH - 1);
+  else
+    s->depth = 1 + kwalk(fp, s->pc + 1, PROF_DEPTH - 1);
+  release(&b->lock);
+}
+
+// Start or stop sampling, or move up to n samples from
+// the per-CPU buffers to user address addr.
+// Returns the number of samples moved, or -1.
+int
+prof(int cmd, int n, uint64 addr)
+{
+  struct proc *p = myproc();
+  struct profbuf *b;
+  int got = 0, m;
+
+  switch(cmd){
+  case PROF_ON:
+    if(n <= 0)
+      return -1;
+    for(b = profbuf; b < &profbuf[NCPU]; b++)
+      b->countdown = n;
+    prof_period = n;
+    return 0;
+  case PROF_OFF:
+    prof_period = 0;
+    return 0;
+  case PROF_READ:
+    for(b = profbuf; b < &profbuf[NCPU] && got < n; b++){
+      acquire(&b->lock);
+      m = b->n < n - got ? b->n : n - got;
+      if(copyout(p->pagetable, addr + got * sizeof(struct profsample),
+                 (char *)b->buf, m * sizeof(struct profsample)) < 0){
+        release(&b->lock);
+        return -1;
+      }
+      // keep any samples that didn't fit, for next time.
+      memmove(b->buf, b->buf + m, (b->n - m) * sizeof(struct profsample));
+      b->n -= m;
+      if(b->lost)
+        klog(KLOG_INFO, "prof: cpu %d dropped %d samples\n", (int)(b - profbuf), b->lost);
+      b->lost = 0;
+      release(&b->lock);
+      got += m;
+    }
+    return got;
+  }
+  return -1;
+}
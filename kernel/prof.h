@@ -0,0 +1,18 @@
+// sampling profiler, for prof().
+
+#define PROF_DEPTH      8    // pcs kept per sample
+#define NPROFSAMPLE   128    // samples buffered per CPU
+
+// commands for prof(cmd, arg, addr)
+#define PROF_ON    1  // sample every arg clock ticks on each CPU
+#define PROF_OFF   2  // stop sampling
+#define PROF_READ  3  // move up to arg samples to addr
+
+struct profsample {
+  int cpu;
+  int pid;                 // 0 if no process was running
+  int user;                // pcs are in pid's user code
+  int depth;               // entries used in pc
+  char name[16];           // the process's name, for finding its .sym
+  uint64 pc[PROF_DEPTH];   // interrupted pc, then return addresses
+};
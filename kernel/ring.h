@@ -0,0 +1,46 @@
+// Submission and completion rings for ring_enter().
+//
+// user memory holds a struct ring, then entries
+// struct ring_sqe, then entries struct ring_cqe.
+// user code fills submissions at sq_tail and takes
+// completions from cq_head; the kernel takes
+// submissions from sq_head and adds completions at
+// cq_tail. indices run freely and are reduced
+// modulo entries, which is a power of two.
+
+#define RING_READ   1  // read(fd, addr, n)
+#define RING_WRITE  2  // write(fd, addr, n)
+#define RING_OPEN   3  // open(addr, n)
+#define RING_CLOSE  4  // close(fd)
+#define RING_PIPE   5  // pipe(addr)
+
+#define RING_MAXENTRIES 256
+
+struct ring_sqe {
+  int op;            // RING_*
+  int fd;
+  uint64 addr;       // buffer, path, or int[2]
+  int n;             // byte count, or open mode
+  int pad;
+  uint64 user_data;  // passed through to the completion
+};
+
+struct ring_cqe {
+  uint64 user_data;  // from the submission
+  int res;           // what the system call would have returned
+  int pad;
+};
+
+struct ring {
+  uint sq_head;      // kernel advances
+  uint sq_tail;      // user advances
+  uint cq_head;      // user advances
+  uint cq_tail;      // kernel advances
+  uint entries;
+  uint pad;
+};
+
+#define RING_SQ(r) ((struct ring_sqe*)((r) + 1))
+#define RING_CQ(r) ((struct ring_cqe*)(RING_SQ(r) + (r)->entries))
+#define RING_SIZE(n) \
+  (sizeof(struct ring) + (n) * (sizeof(struct ring_sqe) + sizeof(struct ring_cqe)))
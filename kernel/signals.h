@@ -3,11 +3,21 @@
 #define SIG_DFL 0 /* default signal handling */
 #define SIG_IGN 1 /* ignore signal */
 #define SIGKILL 9
+#define SIGALRM 14 /* from alarm() and setitimer() */
 #define SIGSTOP 17
 #define SIGCONT 19
+#define SIGCHLD 20 /* a child exited; ignored by default */
 #define SIGNALS_COUNT 32
 typedef void handler(int);
 
+// what sigwaitinfo() and read() on a signalfd return.
+struct siginfo {
+  int signum;
+  uint64 value;  // from sigqueue(), else 0
+};
+
+// a handler may also take a second, uint64 argument:
+// the value passed to sigqueue(), or 0 after kill().
 struct sigaction {
   void (*sa_handler) (int);
   uint sigmask;
@@ -5,6 +5,8 @@
 #include "spinlock.h"
 #include "proc.h"
 #include "syscall.h"
+#include "sysstat.h"
+#include "trace.h"
 #include "defs.h"
 
 // Fetch the uint64 at addr from the current process.
@@ -107,6 +109,23 @@ extern uint64 sys_uptime(void);
 extern uint64 sys_sigprocmask(void);
 extern uint64 sys_sigaction(void);
 extern uint64 sys_sigret(void);
+extern uint64 sys_nanosleep(void);
+extern uint64 sys_nice(void);
+extern uint64 sys_setpriority(void);
+extern uint64 sys_sigqueue(void);
+extern uint64 sys_sigwaitinfo(void);
+extern uint64 sys_signalfd(void);
+extern uint64 sys_waitpid(void);
+extern uint64 sys_setitimer(void);
+extern uint64 sys_setpgid(void);
+extern uint64 sys_getpgid(void);
+extern uint64 sys_dmesg(void);
+extern uint64 sys_setloglevel(void);
+extern uint64 sys_ring_setup(void);
+extern uint64 sys_ring_enter(void);
+extern uint64 sys_sysstat(void);
+extern uint64 sys_prof(void);
+extern uint64 sys_ktrace(void);
 
 static uint64 (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -132,21 +151,118 @@ static uint64 (*syscalls[])(void) = {
 [SYS_close]   sys_close,
 [SYS_sigprocmask] sys_sigprocmask,
 [SYS_sigaction] sys_sigaction,
-[SYS_sigret]  sys_sigret
+[SYS_sigret]  sys_sigret,
+[SYS_nanosleep] sys_nanosleep,
+[SYS_nice]    sys_nice,
+[SYS_setpriority] sys_setpriority,
+[SYS_sigqueue] sys_sigqueue,
+[SYS_sigwaitinfo] sys_sigwaitinfo,
+[SYS_signalfd] sys_signalfd,
+[SYS_waitpid] sys_waitpid,
+[SYS_setitimer] sys_setitimer,
+[SYS_setpgid] sys_setpgid,
+[SYS_getpgid] sys_getpgid,
+[SYS_dmesg]   sys_dmesg,
+[SYS_setloglevel] sys_setloglevel,
+[SYS_ring_setup] sys_ring_setup,
+[SYS_ring_enter] sys_ring_enter,
+[SYS_sysstat] sys_sysstat,
+[SYS_prof]    sys_prof,
+[SYS_ktrace]  sys_ktrace,
 };
 
+// per-CPU counts and latency histograms for each system
+// call, kept while sysstat_on is set. each CPU updates
+// only its own, with interrupts off, so no lock is needed.
+static struct sysstat sysstats[NCPU][NSYSSTAT];
+static int sysstat_on;
+static int sysstat_pid;   // count only this pid's calls, if not 0
+
+static void
+sysstat_add(int num, uint64 t)
+{
+  struct sysstat *s;
+  int b;
+
+  push_off();
+  s = &sysstats[cpuid()][num];
+  s->count++;
+  s->time += t;
+  for(b = 0; b < NSYSHIST - 1 && (t >> (b + 1)) != 0; b++)
+    ;
+  s->hist[b]++;
+  pop_off();
+}
+
 void
 syscall(void)
 {
   int num;
   struct proc *p = myproc();
+  uint64 t0;
 
   num = p->trapframe->a7;
   if(num > 0 && num < NELEM(syscalls) && syscalls[num]) {
-    p->trapframe->a0 = syscalls[num]();
+    trace(TR_SYSENTER, num, p->trapframe->a0);
+    // when accounting is off, this test is all it costs.
+    if(sysstat_on && (sysstat_pid == 0 || sysstat_pid == p->pid)){
+      t0 = r_time();
+      p->trapframe->a0 = syscalls[num]();
+      sysstat_add(num, r_time() - t0);
+    } else {
+      p->trapframe->a0 = syscalls[num]();
+    }
+    trace(TR_SYSEXIT, num, p->trapframe->a0);
   } else {
     printf("%d %s: unknown sys call %d\n",
             p->pid, p->name, num);
     p->trapframe->a0 = -1;
   }
 }
+
+// control system call accounting, or read it out
+// summed over all CPUs, or read the time each CPU has
+// spent parked in idle(). see sysstat.h.
+uint64
+sys_sysstat(void)
+{
+  struct proc *p = myproc();
+  struct sysstat s;
+  int cmd, arg, num, i, c;
+  uint64 addr;
+
+  if(argint(0, &cmd) < 0 || argint(1, &arg) < 0 || argaddr(2, &addr) < 0)
+    return -1;
+  switch(cmd){
+  case SYSSTAT_ON:
+    sysstat_pid = arg;
+    sysstat_on = 1;
+    return 0;
+  case SYSSTAT_OFF:
+    sysstat_on = 0;
+    return 0;
+  case SYSSTAT_RESET:
+    memset(sysstats, 0, sizeof(sysstats));
+    return 0;
+  case SYSSTAT_READ:
+    for(num = 0; num < NSYSSTAT; num++){
+      memset(&s, 0, sizeof(s));
+      for(c = 0; c < NCPU; c++){
+        s.count += sysstats[c][num].count;
+        s.time += sysstats[c][num].time;
+        for(i = 0; i < NSYSHIST; i++)
+          s.hist[i] += sysstats[c][num].hist[i];
+      }
+      if(copyout(p->pagetable, addr + num * sizeof(s), (char *)&s, sizeof(s)) < 0)
+        return -1;
+    }
+    return 0;
+  case SYSSTAT_IDLE:
+    for(c = 0; c < NCPU; c++)
+      if(copyout(p->pagetable, addr + c * sizeof(uint64),
+                 (char *)&cpus[c].idletime, sizeof(uint64)) < 0)
+        return -1;
+    return 0;
+  }
+  return -1;
+}
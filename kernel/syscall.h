@@ -22,4 +22,21 @@
 #define SYS_close  21
 #define SYS_sigprocmask 22
 #define SYS_sigaction 23
-#define SYS_sigret 24
\ No newline at end of file
+#define SYS_sigret 24
+#define SYS_nanosleep 25
+#define SYS_nice   26
+#define SYS_setpriority 27
+#define SYS_sigqueue 28
+#define SYS_sigwaitinfo 29
+#define SYS_signalfd 30
+#define SYS_waitpid 31
+#define SYS_setitimer 32
+#define SYS_setpgid 33
+#define SYS_getpgid 34
+#define SYS_dmesg 35
+#define SYS_setloglevel 36
+#define SYS_ring_setup 37
+#define SYS_ring_enter 38
+#define SYS_sysstat 39
+#define SYS_prof 40
+#define SYS_ktrace 41
\ No newline at end of file
@@ -15,6 +15,16 @@
 #include "sleeplock.h"
 #include "file.h"
 #include "fcntl.h"
+#include "ring.h"
+
+// Return the open file for descriptor fd, or 0.
+static struct file*
+fdfile(int fd)
+{
+  if(fd < 0 || fd >= NOFILE)
+    return 0;
+  return myproc()->ofile[fd];
+}
 
 // Fetch the nth word-sized system call argument as a file descriptor
 // and return both the descriptor and the corresponding struct file.
@@ -26,7 +36,7 @@ argfd(int n, int *pfd, struct file **pf)
 
   if(argint(n, &fd) < 0)
     return -1;
-  if(fd < 0 || fd >= NOFILE || (f=myproc()->ofile[fd]) == 0)
+  if((f = fdfile(fd)) == 0)
     return -1;
   if(pfd)
     *pfd = fd;
@@ -91,19 +101,28 @@ sys_write(void)
   return filewrite(f, p, n);
 }
 
-uint64
-sys_close(void)
+static int
+fdclose(int fd)
 {
-  int fd;
   struct file *f;
 
-  if(argfd(0, &fd, &f) < 0)
+  if((f = fdfile(fd)) == 0)
     return -1;
   myproc()->ofile[fd] = 0;
   fileclose(f);
   return 0;
 }
 
+uint64
+sys_close(void)
+{
+  int fd;
+
+  if(argfd(0, &fd, 0) < 0)
+    return -1;
+  return fdclose(fd);
+}
+
 uint64
 sys_fstat(void)
 {
@@ -283,17 +302,13 @@ create(char *path, short type, short major, short minor)
   return ip;
 }
 
-uint64
-sys_open(void)
+// open path, and return a new file descriptor for it.
+static int
+fileopen(char *path, int omode)
 {
-  char path[MAXPATH];
-  int fd, omode;
+  int fd;
   struct file *f;
   struct inode *ip;
-  int n;
-
-  if((n = argstr(0, path, MAXPATH)) < 0 || argint(1, &omode) < 0)
-    return -1;
 
   begin_op();
 
@@ -351,6 +366,17 @@ sys_open(void)
   return fd;
 }
 
+uint64
+sys_open(void)
+{
+  char path[MAXPATH];
+  int omode;
+
+  if(argstr(0, path, MAXPATH) < 0 || argint(1, &omode) < 0)
+    return -1;
+  return fileopen(path, omode);
+}
+
 uint64
 sys_mkdir(void)
 {
@@ -454,16 +480,40 @@ sys_exec(void)
   return -1;
 }
 
+// a read-only descriptor whose read()s take the caller's
+// pending signals in mask, as struct siginfo records,
+// instead of running their handlers.
 uint64
-sys_pipe(void)
+sys_signalfd(void)
+{
+  int mask;
+  int fd;
+  struct file *f;
+
+  if(argint(0, &mask) < 0)
+    return -1;
+  if((f = filealloc()) == 0)
+    return -1;
+  if((fd = fdalloc(f)) < 0){
+    fileclose(f);
+    return -1;
+  }
+  f->type = FD_SIGNAL;
+  f->readable = 1;
+  f->writable = 0;
+  f->sigmask = mask;
+  return fd;
+}
+
+// make a pipe, and store its read and write descriptors
+// at user address fdarray.
+static int
+pipefds(uint64 fdarray)
 {
-  uint64 fdarray; // user pointer to array of two integers
   struct file *rf, *wf;
   int fd0, fd1;
   struct proc *p = myproc();
 
-  if(argaddr(0, &fdarray) < 0)
-    return -1;
   if(pipealloc(&rf, &wf) < 0)
     return -1;
   fd0 = -1;
@@ -484,3 +534,144 @@ sys_pipe(void)
   }
   return 0;
 }
+
+uint64
+sys_pipe(void)
+{
+  uint64 fdarray; // user pointer to array of two integers
+
+  if(argaddr(0, &fdarray) < 0)
+    return -1;
+  return pipefds(fdarray);
+}
+
+// Register a struct ring at user address addr, with the
+// given number of entries in each of its two rings,
+// for ring_enter(). entries 0 unregisters.
+uint64
+sys_ring_setup(void)
+{
+  struct proc *p = myproc();
+  struct ring r;
+  uint64 addr;
+  int n;
+
+  if(argaddr(0, &addr) < 0 || argint(1, &n) < 0)
+    return -1;
+  if(n == 0){
+    p->ring = 0;
+    p->ringentries = 0;
+    return 0;
+  }
+  if(n < 0 || n > RING_MAXENTRIES || (n & (n - 1)) != 0)
+    return -1;
+  if(addr % sizeof(uint64) != 0 || addr + RING_SIZE(n) > p->sz)
+    return -1;
+  memset(&r, 0, sizeof(r));
+  r.entries = n;
+  if(copyout(p->pagetable, addr, (char *)&r, sizeof(r)) < 0)
+    return -1;
+  p->ring = addr;
+  p->ringentries = n;
+  return 0;
+}
+
+// carry out one submission, returning what the
+// corresponding system call would have.
+static int
+ring_do(struct ring_sqe *e)
+{
+  char path[MAXPATH];
+  struct file *f;
+
+  switch(e->op){
+  case RING_READ:
+    if((f = fdfile(e->fd)) == 0)
+      return -1;
+    return fileread(f, e->addr, e->n);
+  case RING_WRITE:
+    if((f = fdfile(e->fd)) == 0)
+      return -1;
+    return filewrite(f, e->addr, e->n);
+  case RING_OPEN:
+    if(fetchstr(e->addr, path, MAXPATH) < 0)
+      return -1;
+    return fileopen(path, e->n);
+  case RING_CLOSE:
+    return fdclose(e->fd);
+  case RING_PIPE:
+    return pipefds(e->addr);
+  }
+  return -1;
+}
+
+// Write back the ring indices the kernel owns.
+static int
+ring_indices(struct proc *p, struct ring *r)
+{
+  if(copyout(p->pagetable, p->ring + offsetof(struct ring, sq_head),
+             (char *)&r->sq_head, sizeof(r->sq_head)) < 0 ||
+     copyout(p->pagetable, p->ring + offsetof(struct ring, cq_tail),
+             (char *)&r->cq_tail, sizeof(r->cq_tail)) < 0)
+    return -1;
+  return 0;
+}
+
+// Carry out up to n queued submissions, in order, posting
+// a completion for each, all in one kernel entry. Stops
+// early if the completion ring fills up, or the ring
+// can't be read or written.
+// Returns the number of submissions consumed, which user
+// space also sees in sq_head, or -1 if none could be.
+uint64
+sys_ring_enter(void)
+{
+  struct proc *p = myproc();
+  struct ring r;
+  struct ring_sqe e;
+  struct ring_cqe c;
+  uint64 sq, cq, ca;
+  uint mask;
+  int n, done, err = 0;
+
+  if(argint(0, &n) < 0 || p->ring == 0)
+    return -1;
+  if(copyin(p->pagetable, (char *)&r, p->ring, sizeof(r)) < 0)
+    return -1;
+  // entries is user-writable; trust only ring_setup()'s.
+  mask = p->ringentries - 1;
+  sq = p->ring + sizeof(struct ring);
+  cq = sq + p->ringentries * sizeof(struct ring_sqe);
+
+  for(done = 0; done < n && r.sq_head != r.sq_tail; done++){
+    if(r.cq_tail - r.cq_head >= p->ringentries)
+      break;
+    if(copyin(p->pagetable, (char *)&e, sq + (r.sq_head & mask) * sizeof(e), sizeof(e)) < 0){
+      err = 1;
+      break;
+    }
+    // write the completion slot and the indices before
+    // carrying out e, so that once it has side effects
+    // the writes below can't fail, and a retry never
+    // repeats it. the process has only this thread, so
+    // nothing can unmap them in between.
+    ca = cq + (r.cq_tail & mask) * sizeof(c);
+    c.user_data = e.user_data;
+    c.res = -1;
+    c.pad = 0;
+    if(copyout(p->pagetable, ca, (char *)&c, sizeof(c)) < 0 || ring_indices(p, &r) < 0){
+      err = 1;
+      break;
+    }
+    c.res = ring_do(&e);
+    r.sq_head++;
+    r.cq_tail++;
+    copyout(p->pagetable, ca, (char *)&c, sizeof(c));
+    ring_indices(p, &r);
+    if(p->killed){
+      done++;
+      break;
+    }
+  }
+  return done == 0 && err ? -1 : done;
+}
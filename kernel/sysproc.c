@@ -38,6 +38,16 @@ sys_wait(void)
   return wait(p);
 }
 
+uint64
+sys_waitpid(void)
+{
+  int pid, options;
+  uint64 p;
+  if(argint(0, &pid) < 0 || argaddr(1, &p) < 0 || argint(2, &options) < 0)
+    return -1;
+  return waitpid(pid, p, options);
+}
+
 uint64
 sys_sbrk(void)
 {
@@ -52,27 +62,76 @@ sys_sbrk(void)
   return addr;
 }
 
-uint64
-sys_sleep(void)
+static void
+sleep_expired(struct timer *t)
 {
-  int n;
+  wakeup(t);
+}
+
+// Sleep for n clock ticks on a timer of our own, so only
+// clockintr()'s expiry of that timer wakes us.
+// Returns -1 if a signal cut the sleep short.
+static int
+ticksleep(uint n)
+{
+  struct timer t;
   uint ticks0;
 
-  if(argint(0, &n) < 0)
-    return -1;
+  memset(&t, 0, sizeof(t));
+  t.fn = sleep_expired;
   acquire(&tickslock);
   ticks0 = ticks;
+  timer_add(&t, ticks0 + n);
   while(ticks - ticks0 < n){
-    if(myproc()->killed){
+    if(signal_pending(myproc())){
+      timer_del(&t);
       release(&tickslock);
       return -1;
     }
-    sleep(&ticks, &tickslock);
+    sleep_intr(&t, &tickslock);
   }
+  timer_del(&t);
   release(&tickslock);
   return 0;
 }
 
+uint64
+sys_sleep(void)
+{
+  int n;
+
+  if(argint(0, &n) < 0)
+    return -1;
+  if(n <= 0)
+    return 0;
+  return ticksleep(n);
+}
+
+// sleep for a number of nanoseconds, with the resolution
+// of the time CSR rather than of the clock tick. whole
+// ticks are slept on the timing wheel; the last fraction
+// of a tick is spent in yield() until the deadline passes.
+uint64
+sys_nanosleep(void)
+{
+  uint64 ns, now, deadline;
+
+  if(argaddr(0, &ns) < 0)
+    return -1;
+  deadline = r_time() + ns / (1000000000L / MTIME_FREQ);
+  while((now = r_time()) < deadline){
+    if(signal_pending(myproc()))
+      return -1;
+    if(deadline - now > TICKINTERVAL){
+      if(ticksleep((deadline - now) / TICKINTERVAL) < 0)
+        return -1;
+    } else {
+      yield();
+    }
+  }
+  return 0;
+}
+
 uint64
 sys_kill(void)
 {
@@ -83,6 +142,112 @@ sys_kill(void)
   return kill(pid, signum);
 }
 
+uint64
+sys_sigqueue(void)
+{
+  int pid;
+  int signum;
+  uint64 value;
+  if (argint(0, &pid) < 0 || argint(1, &signum) < 0 ||
+      argaddr(2, &value) < 0)
+      return -1;
+  return sigqueue(pid, signum, value);
+}
+
+// wait for a signal in mask, and take it without
+// running its handler. returns the signal number.
+uint64
+sys_sigwaitinfo(void)
+{
+  int mask;
+  uint64 addr;
+  struct siginfo si;
+
+  if(argint(0, &mask) < 0 || argaddr(1, &addr) < 0)
+    return -1;
+  if((si.signum = sigtake(mask, &si.value, 1)) < 0)
+    return -1;
+  if(addr != 0 && copyout(myproc()->pagetable, addr, (char *)&si, sizeof(si)) < 0)
+    return -1;
+  return si.signum;
+}
+
+// copy the kernel log out to user space.
+uint64
+sys_dmesg(void)
+{
+  uint64 addr;
+  int n;
+
+  if(argaddr(0, &addr) < 0 || argint(1, &n) < 0)
+    return -1;
+  return dmesg(addr, n);
+}
+
+uint64
+sys_setloglevel(void)
+{
+  int level;
+
+  if(argint(0, &level) < 0)
+    return -1;
+  return setloglevel(level);
+}
+
+uint64
+sys_prof(void)
+{
+  int cmd, n;
+  uint64 addr;
+
+  if(argint(0, &cmd) < 0 || argint(1, &n) < 0 || argaddr(2, &addr) < 0)
+    return -1;
+  return prof(cmd, n, addr);
+}
+
+uint64
+sys_ktrace(void)
+{
+  int cmd, n;
+  uint64 addr;
+
+  if(argint(0, &cmd) < 0 || argint(1, &n) < 0 || argaddr(2, &addr) < 0)
+    return -1;
+  return ktrace(cmd, n, addr);
+}
+
+uint64
+sys_setpgid(void)
+{
+  int pid, pgid;
+
+  if(argint(0, &pid) < 0 || argint(1, &pgid) < 0)
+    return -1;
+  return setpgid(pid, pgid);
+}
+
+uint64
+sys_getpgid(void)
+{
+  int pid;
+
+  if(argint(0, &pid) < 0)
+    return -1;
+  return getpgid(pid);
+}
+
+uint64
+sys_setitimer(void)
+{
+  int value, interval;
+
+  if(argint(0, &value) < 0 || argint(1, &interval) < 0)
+    return -1;
+  if(value < 0 || interval < 0)
+    return -1;
+  return setitimer(value, interval);
+}
+
 // return how many clock tick interrupts have occurred
 // since start.
 uint64
@@ -96,6 +261,34 @@ sys_uptime(void)
   return xticks;
 }
 
+// add inc to the caller's nice value; return the new one.
+uint64
+sys_nice(void)
+{
+  int inc;
+
+  if(argint(0, &inc) < 0)
+    return -1;
+  // no larger step matters, and this keeps the sum in range.
+  if(inc < NICE_MIN - NICE_MAX)
+    inc = NICE_MIN - NICE_MAX;
+  if(inc > NICE_MAX - NICE_MIN)
+    inc = NICE_MAX - NICE_MIN;
+  if(setnice(0, myproc()->nice + inc) < 0)
+    return -1;
+  return myproc()->nice;
+}
+
+uint64
+sys_setpriority(void)
+{
+  int pid, nice;
+
+  if(argint(0, &pid) < 0 || argint(1, &nice) < 0)
+    return -1;
+  return setnice(pid, nice);
+}
+
 uint64
 sys_sigprocmask(void)
 {
@@ -119,9 +312,12 @@ sys_sigaction(void)
   return sigaction(signum, act_addr, old_act_addr);
 }
 
+// the restored a0 is the return value, so that
+// syscall() leaves the interrupted context intact.
 uint64
 sys_sigret(void)
 {
-  sigret();
-  return 0;
+  if(sigret() < 0)
+    return -1;
+  return myproc()->trapframe->a0;
 }
\ No newline at end of file
@@ -0,0 +1,18 @@
+// system call accounting, for sysstat().
+
+#define NSYSSTAT  64  // system call numbers accounted for
+#define NSYSHIST  32  // log2 latency histogram buckets
+
+// commands for sysstat(cmd, arg, addr)
+#define SYSSTAT_ON     1  // start counting calls by pid arg, or all if 0
+#define SYSSTAT_OFF    2  // stop counting
+#define SYSSTAT_RESET  3  // zero the counts
+#define SYSSTAT_READ   4  // copy struct sysstat[NSYSSTAT] to addr
+#define SYSSTAT_IDLE   5  // copy each CPU's idle time, uint64[NCPU], to addr
+
+// one system call's totals; times are in time CSR ticks.
+struct sysstat {
+  uint64 count;
+  uint64 time;            // summed over all calls
+  uint64 hist[NSYSHIST];  // hist[i]: calls taking < 2^(i+1) ticks
+};
@@ -0,0 +1,80 @@
+//
+// timing wheel for clock tick timers.
+//
+// a pending timer lives in slot expires % NTIMERSLOT.
+// each clock tick looks only at the current slot, and
+// leaves timers that are one or more whole turns of the
+// wheel away where they are. so a tick costs time in
+// proportion to the timers in one slot, not to the
+// number of sleeping processes.
+//
+
+#include "types.h"
+#include "param.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "timer.h"
+#include "defs.h"
+
+static struct timer *wheel[NTIMERSLOT];
+
+// Arm t to call t->fn at tick expires.
+// t must not be pending; the caller sets t->fn and t->arg.
+// tickslock must be held.
+void
+timer_add(struct timer *t, uint expires)
+{
+  struct timer **slot;
+
+  if(!holding(&tickslock))
+    panic("timer_add");
+  if(t->pprev)
+    panic("timer_add pending");
+  t->expires = expires;
+  slot = &wheel[expires % NTIMERSLOT];
+  t->next = *slot;
+  if(*slot)
+    (*slot)->pprev = &t->next;
+  *slot = t;
+  t->pprev = slot;
+}
+
+// Disarm t, if it is still pending.
+// tickslock must be held.
+void
+timer_del(struct timer *t)
+{
+  if(!holding(&tickslock))
+    panic("timer_del");
+  if(t->pprev == 0)
+    return;
+  *t->pprev = t->next;
+  if(t->next)
+    t->next->pprev = t->pprev;
+  t->next = 0;
+  t->pprev = 0;
+}
+
+// Is t armed?
+// tickslock must be held.
+int
+timer_pending(struct timer *t)
+{
+  return t->pprev != 0;
+}
+
+// Fire the timers that expire at the current tick.
+// Called by clockintr() with tickslock held.
+void
+timer_tick(void)
+{
+  struct timer *t, *next;
+
+  for(t = wheel[ticks % NTIMERSLOT]; t; t = next){
+    next = t->next;
+    if((int)(t->expires - ticks) > 0)
+      continue;
+    timer_del(t);
+    t->fn(t);
+  }
+}
@@ -0,0 +1,10 @@
+// A one-shot callback at a given clock tick.
+// Pending timers hang off the timing wheel in timer.c;
+// tickslock protects them.
+struct timer {
+  uint expires;               // value of ticks at which to fire
+  void (*fn)(struct timer*);  // called from clockintr(), tickslock held
+  void *arg;                  // for fn
+  struct timer *next;         // next timer in the same wheel slot
+  struct timer **pprev;       // pointer to this timer; 0 if not pending
+};
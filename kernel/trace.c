@@ -0,0 +1,128 @@
+//
+// static kernel tracepoints.
+//
+// trace() calls sit at fixed points in the kernel:
+// context switches, sleep and wakeup, system call entry
+// and exit, disk requests, and signals. while ktrace()
+// has enabled its type, each call appends a fixed-size
+// record to a ring belonging to the calling CPU.
+//
+// only that CPU, with interrupts off, ever advances a
+// ring's head, and only ktrace() its tail, so recording
+// an event takes no lock. a record that would overwrite
+// one not yet read is dropped instead.
+//
+
+#include "types.h"
+#include "param.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "trace.h"
+#include "klog.h"
+#include "defs.h"
+
+static uint trace_mask;  // 1 << type for each enabled type
+
+static struct tracebuf {
+  uint64 head;   // records ever written; set by this CPU only
+  uint64 tail;   // records ever read; set by ktrace() only
+  uint64 lost;   // records dropped; set by this CPU only
+  uint64 lostseen;
+  struct traceev buf[NTRACE];
+} tracebuf[NCPU];
+
+// serializes readers; the CPUs recording never take it.
+static struct spinlock tracelock;
+
+void
+traceinit(void)
+{
+  initlock(&tracelock, "trace");
+}
+
+// Record an event of the given type, if it is enabled.
+void
+trace(int type, uint64 a0, uint64 a1)
+{
+  struct tracebuf *b;
+  struct traceev *e;
+  struct proc *p;
+
+  if((trace_mask & (1 << type)) == 0)
+    return;
+
+  push_off();
+  b = &tracebuf[cpuid()];
+  if(b->head - b->tail >= NTRACE){
+    b->lost++;
+    pop_off();
+    return;
+  }
+  e = &b->buf[b->head % NTRACE];
+  p = mycpu()->proc;
+  e->time = r_time();
+  e->type = type;
+  e->cpu = cpuid();
+  e->pid = p ? p->pid : 0;
+  e->a0 = a0;
+  e->a1 = a1;
+  // ktrace() must see the record before the new head.
+  __sync_synchronize();
+  b->head++;
+  pop_off();
+}
+
+// Start or stop recording, or move up to n records from
+// the per-CPU rings to user address addr, one CPU's
+// after another, each CPU's oldest first.
+// Returns the number of records moved, or -1.
+int
+ktrace(int cmd, int n, uint64 addr)
+{
+  struct proc *p = myproc();
+  struct tracebuf *b;
+  uint64 head, tail;
+  int got = 0, m, i;
+
+  switch(cmd){
+  case KTRACE_ON:
+    trace_mask = n ? n : ~0;
+    return 0;
+  case KTRACE_OFF:
+    trace_mask = 0;
+    return 0;
+  case KTRACE_READ:
+    acquire(&tracelock);
+    for(b = tracebuf; b < &tracebuf[NCPU] && got < n; b++){
+      head = b->head;
+      // read no record before seeing its head.
+      __sync_synchronize();
+      for(tail = b->tail; tail < head && got < n; tail += m, got += m){
+        // the ring may wrap: copy up to the end of buf.
+        i = tail % NTRACE;
+        m = head - tail;
+        if(m > NTRACE - i)
+          m = NTRACE - i;
+        if(m > n - got)
+          m = n - got;
+        if(copyout(p->pagetable, addr + got * sizeof(struct traceev),
+                   (char *)&b->buf[i], m * sizeof(struct traceev)) < 0){
+          release(&tracelock);
+          return -1;
+        }
+      }
+      // done reading before the CPU may reuse the slots.
+      __sync_synchronize();
+      b->tail = tail;
+      if(b->lost != b->lostseen){
+        klog(KLOG_INFO, "trace: cpu %d dropped %d records\n",
+             (int)(b - tracebuf), (int)(b->lost - b->lostseen));
+        b->lostseen = b->lost;
+      }
+    }
+    release(&tracelock);
+    return got;
+  }
+  return -1;
+}
@@ -0,0 +1,29 @@
+// static tracepoints, for trace() and ktrace().
+
+// event types; ktrace(KTRACE_ON, mask, 0) records those
+// whose bit (1 << type) is set in mask.
+#define TR_SWITCH     1  // scheduler() runs pid a0
+#define TR_SCHED      2  // the process leaves the CPU in state a0
+#define TR_SLEEP      3  // the process sleeps on chan a0
+#define TR_WAKEUP     4  // pid a0, sleeping on chan a1, is woken
+#define TR_SYSENTER   5  // system call a0, first argument a1
+#define TR_SYSEXIT    6  // system call a0 returns a1
+#define TR_DISKSUB    7  // disk request for block a0, a write if a1
+#define TR_DISKDONE   8  // disk request for block a0 completes
+#define TR_SIGPOST    9  // signal a1 posted to pid a0
+#define TR_SIGDELIVER 10 // signal a0 delivered, to handler a1
+#define NTRACETYPE    11
+
+// commands for ktrace(cmd, arg, addr)
+#define KTRACE_ON    1  // record the events in mask arg, or all if 0
+#define KTRACE_OFF   2  // stop recording
+#define KTRACE_READ  3  // move up to arg records to addr
+
+// one event, as recorded in a per-CPU ring.
+struct traceev {
+  uint64 time;    // time CSR when recorded
+  ushort type;    // TR_*
+  ushort cpu;
+  int pid;        // the process running then, or 0
+  uint64 a0, a1;  // event arguments, as above
+};
@@ -4,10 +4,13 @@
 #include "riscv.h"
 #include "spinlock.h"
 #include "proc.h"
+#include "klog.h"
+#include "trace.h"
 #include "defs.h"
 
 struct spinlock tickslock;
 uint ticks;
+struct vdso *vdso;  // mapped read-only at VDSO in every process
 
 extern char trampoline[], uservec[], userret[];
 
@@ -20,6 +23,11 @@ void
 trapinit(void)
 {
 	initlock(&tickslock, "time");
+
+	if((vdso = (struct vdso*)kalloc()) == 0)
+		panic("trapinit: vdso");
+	memset(vdso, 0, PGSIZE);
+	vdso->timefreq = MTIME_FREQ;
 }
 
 // set up to take exceptions and traps while in the kernel.
@@ -27,6 +35,10 @@ void
 trapinithart(void)
 {
 	w_stvec((uint64)kernelvec);
+
+	// let user code read the time CSR, for timing
+	// without a system call.
+	w_scounteren(r_scounteren() | 2);
 }
 
 //
@@ -76,86 +88,86 @@ usertrap(void)
 		exit(-1);
 
 	// give up the CPU if this is a timer interrupt.
-	if(which_dev == 2)
+	if(which_dev == 2){
+		prof_tick(1, p->trapframe->epc, p->trapframe->s0);
 		yield();
+	}
 
 	usertrapret();
 }
 
-//this function has to be before sigret end
+// Arrange for the return to user space to enter p's
+// handler for signum. The current context and mask are
+// saved in a struct sigframe on the user stack, and the
+// handler runs just below it. It returns to the sigreturn
+// trampoline page (sigtramp.S), whose sigret() call
+// restores the frame. If another signal is delivered
+// before we get back to user space, its frame goes on top
+// of this one, and its sigret() resumes at this handler.
+// The handler gets signum in a0 and the value
+// from sigqueue(), if any, in a1.
+// p is killed if the frame doesn't fit.
 void
-call_sigret(){
-	asm ("li a7, 24\necall");
-}
-void
-sigret_end(){
-}
-void
-handle_user_signal(struct proc *p, int signum, uint64 satp)
+handle_user_signal(struct proc *p, int signum, uint64 value)
 {
-
-	uint64 sa_handler = (uint64)p->signal_handlers[signum];
-	p->trapframe->sp -= sizeof(struct trapframe);
-	*(p->trapframe_backup) = *(p->trapframe);
-	if(copyout(p->pagetable, p->trapframe_backup->sp, (char *)p->trapframe, sizeof(struct trapframe)) < 0){
-		return;
-	}
-	p->trapframe->epc = sa_handler;
-	int sigret_function_size = (sigret_end - call_sigret);
-	p->trapframe->sp -= sigret_function_size;
-	if(copyout(p->pagetable, p->trapframe->sp, (char *)call_sigret, sigret_function_size) < 0){
+	struct sigframe f;
+	uint64 sp;
+
+	f.tf = *(p->trapframe);
+	f.mask = p->signal_mask;
+	f.magic = SIGFRAME_MAGIC;
+	sp = (p->trapframe->sp - sizeof(f)) & ~0xfL;
+	if(copyout(p->pagetable, sp, (char *)&f, sizeof(f)) < 0){
+		p->killed = 1;
 		return;
 	}
-	p->trapframe->ra = p->trapframe->sp;
+	p->trapframe->sp = sp;
+	p->trapframe->epc = (uint64)p->signal_handlers[signum];
+	p->trapframe->ra = SIGTRAMPOLINE;
 	p->trapframe->a0 = signum;
-	p->pending_signals = 0 << signum & p->pending_signals;
-	w_sepc(p->trapframe->epc);
-	uint64 fn = TRAMPOLINE + (userret - trampoline);
-	((void (*)(uint64,uint64))fn)(TRAPFRAME, satp);
-}
-
-void
-handle_kernel_signal(struct proc *p, int signum)
-{
-	handler* sa_handler = (handler*)p->signal_handlers[signum];
-	sa_handler(signum);
-	p->signal_mask = p->signal_mask_backup;
-	p->is_handling_signal = 0;
-	p->pending_signals = 0 << signum & p->pending_signals;
+	p->trapframe->a1 = value;
+	// block signum, and whatever sigaction() asked for,
+	// until the handler returns.
+	p->signal_mask |= p->signal_handlers_masks[signum] | 1 << signum;
 }
 
 void
-handle_signal(struct proc *p, int signum, uint64 satp){
-	p->signal_mask_backup = p->signal_mask;
-	p->signal_mask = p->signal_handlers_masks[signum];
-	p->is_handling_signal = 1;
-	void* handler = p->signal_handlers[signum];
-	if(handler == sigkill_handler 
-	|| handler == sigcont_handler 
-	|| handler == sigstop_handler 
-	|| handler == sigign_handler)
-	{
-		printf("handling kernel signal...\n");
-		handle_kernel_signal(p, signum);
+handle_signal(struct proc *p, int signum){
+	handler *h = (handler*)p->signal_handlers[signum];
+	uint64 value;
+
+	__sync_fetch_and_and(&p->pending_signals, ~(1 << signum));
+	value = sigdequeue(p, signum);
+	klog(KLOG_TRACE, "pid %d: signal %d handler %p\n", p->pid, signum, (uint64)h);
+	trace(TR_SIGDELIVER, signum, (uint64)h);
+	if(sigkernel(h)){
+		h(signum);
 		return;
 	}
-	printf("handling user signal...\n");
-	handle_user_signal(p, signum, satp);
+	handle_user_signal(p, signum, value);
 }
 
+// Deliver every pending signal that isn't blocked.
+// Kernel dispositions run here and now; user handlers
+// get stacked frames, so that they all run back to back
+// before the interrupted code resumes. Each handler
+// adds to the mask, which keeps the loop finite.
 void
-check_pending_signals(struct proc *p, uint64 satp)
+check_pending_signals(struct proc *p)
 {
-	if (p->is_handling_signal){
-		return;
-	}
-	for(int i = 0; i < SIGNALS_COUNT; i++){
-		int is_blocked = (1 << i & p->signal_mask);
-		int is_set = (1 << i & p->pending_signals);
-		if(!is_blocked && is_set){
-			printf("handling signal number: %d\n", i);
-			handle_signal(p, i, satp);
-		}
+	uint deliverable;
+	int i;
+
+	for(;;){
+		if(p->killed)
+			return;
+		deliverable = p->pending_signals &
+			(~p->signal_mask | 1 << SIGKILL | 1 << SIGSTOP);
+		if(deliverable == 0)
+			return;
+		for(i = 0; (deliverable & (1 << i)) == 0; i++)
+			;
+		handle_signal(p, i);
 	}
 }
 
@@ -167,6 +179,13 @@ usertrapret(void)
 {
 	struct proc *p = myproc();
 
+	// act on signals before committing to the return path
+	// below: a user handler only edits the trapframe, but
+	// SIGSTOP gives up the CPU, which needs kernelvec.
+	check_pending_signals(p);
+	if(p->killed)
+		exit(-1);
+
 	// we're about to switch the destination of traps from
 	// kerneltrap() to usertrap(), so turn off interrupts until
 	// we're back in user space, where usertrap() is correct.
@@ -197,8 +216,6 @@ usertrapret(void)
 	// tell trampoline.S the user page table to switch to.
 	uint64 satp = MAKE_SATP(p->pagetable);
 
-	check_pending_signals(p, satp);
-
 	// jump to trampoline.S at the top of memory, which 
 	// switches to the user page table, restores user registers,
 	// and switches to user mode with sret.
@@ -210,8 +227,9 @@ usertrapret(void)
 
 // interrupts and exceptions from kernel code go here via kernelvec,
 // on whatever the current kernel stack is.
+// fp is the interrupted code's frame pointer.
 void 
-kerneltrap()
+kerneltrap(uint64 fp)
 {
 	int which_dev = 0;
 	uint64 sepc = r_sepc();
@@ -229,6 +247,9 @@ kerneltrap()
 		panic("kerneltrap");
 	}
 
+	if(which_dev == 2)
+		prof_tick(0, sepc, fp);
+
 	// give up the CPU if this is a timer interrupt.
 	if(which_dev == 2 && myproc() != 0 && myproc()->state == RUNNING)
 		yield();
@@ -244,7 +265,8 @@ clockintr()
 {
 	acquire(&tickslock);
 	ticks++;
-	wakeup(&ticks);
+	vdso->ticks = ticks;
+	timer_tick();
 	release(&tickslock);
 }
 
@@ -281,16 +303,21 @@ devintr()
 
 		return 1;
 	} else if(scause == 0x8000000000000001L){
-		// software interrupt from a machine-mode timer interrupt,
-		// forwarded by timervec in kernelvec.S.
+		// software interrupt from a machine-mode timer interrupt
+		// or wakeup IPI, forwarded by timervec in kernelvec.S.
+
+		// acknowledge the software interrupt by clearing
+		// the SSIP bit in sip. do it before asking timer_fired(),
+		// so a tick that arrives after that raises SSIP again.
+		w_sip(r_sip() & ~2);
+
+		// a wakeup IPI only needs to get a CPU out of wfi.
+		if(!timer_fired())
+			return 1;
 
 		if(cpuid() == 0){
 			clockintr();
 		}
-		
-		// acknowledge the software interrupt by clearing
-		// the SSIP bit in sip.
-		w_sip(r_sip() & ~2);
 
 		return 2;
 	} else {
@@ -16,6 +16,7 @@
 #include "fs.h"
 #include "buf.h"
 #include "virtio.h"
+#include "trace.h"
 
 // the address of virtio mmio register r.
 #define R(r) ((volatile uint32 *)(VIRTIO0 + (r)))
@@ -267,6 +268,7 @@ virtio_disk_rw(struct buf *b, int write)
   __sync_synchronize();
 
   *R(VIRTIO_MMIO_QUEUE_NOTIFY) = 0; // value is queue number
+  trace(TR_DISKSUB, b->blockno, write);
 
   // Wait for virtio_disk_intr() to say request has finished.
   while(b->disk == 1) {
@@ -306,6 +308,7 @@ virtio_disk_intr()
 
     struct buf *b = disk.info[id].b;
     b->disk = 0;   // disk is done with buf
+    trace(TR_DISKDONE, b->blockno, 0);
     wakeup(b);
 
     disk.used_idx += 1;
@@ -30,6 +30,9 @@ kvmmake(void)
   // virtio mmio disk interface
   kvmmap(kpgtbl, VIRTIO0, VIRTIO0, PGSIZE, PTE_R | PTE_W);
 
+  // CLINT MSIP registers, for wakeup IPIs
+  kvmmap(kpgtbl, CLINT, CLINT, PGSIZE, PTE_R | PTE_W);
+
   // PLIC
   kvmmap(kpgtbl, PLIC, PLIC, 0x400000, PTE_R | PTE_W);
 
@@ -43,9 +46,14 @@ kvmmake(void)
   // the highest virtual address in the kernel.
   kvmmap(kpgtbl, TRAMPOLINE, (uint64)trampoline, PGSIZE, PTE_R | PTE_X);
 
-  // map kernel stacks
-  proc_mapstacks(kpgtbl);
-  
+  // kernel stacks are mapped on demand by kvmallocpage(),
+  // and may be unmapped again by kvmfreepage(). make the
+  // page-table pages for every stack slot now, so those
+  // never allocate, and never leak, a page-table page.
+  for(int i = 0; i < NPROC; i++)
+    if(walk(kpgtbl, KSTACK(i), 1) == 0)
+      panic("kvmmake: kstack");
+
   return kpgtbl;
 }
 
@@ -56,6 +64,41 @@ kvminit(void)
   kernel_pagetable = kvmmake();
 }
 
+// Allocate a physical page and map it at va, a kernel
+// stack slot, in the kernel page table. Callers must
+// serialize calls. Only flushes this CPU's TLB.
+// Returns 0 on success, -1 if out of memory.
+int
+kvmallocpage(uint64 va)
+{
+  char *pa;
+
+  if((pa = kalloc()) == 0)
+    return -1;
+  if(mappages(kernel_pagetable, va, PGSIZE, (uint64)pa, PTE_R | PTE_W) != 0){
+    kfree(pa);
+    return -1;
+  }
+  sfence_vma();
+  return 0;
+}
+
+// Unmap the page that kvmallocpage() mapped at va, and
+// free it. Other CPUs may keep a stale TLB entry for va;
+// the caller must see that va isn't used again until it
+// has been remapped and those CPUs have flushed.
+void
+kvmfreepage(uint64 va)
+{
+  pte_t *pte;
+
+  if((pte = walk(kernel_pagetable, va, 0)) == 0 || (*pte & PTE_V) == 0)
+    panic("kvmfreepage");
+  kfree((void*)PTE2PA(*pte));
+  *pte = 0;
+  sfence_vma();
+}
+
 // Switch h/w page table register to the kernel's page table,
 // and enable paging.
 void
@@ -0,0 +1,4 @@
+#define WNOHANG   0x001  // waitpid: return 0 rather than block
+#define WUNTRACED 0x002  // waitpid: also return children that stop
+
+#define WSTOPPED  0x7f   // status waitpid gives for a stopped child
@@ -0,0 +1,29 @@
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "user/user.h"
+
+// print the kernel log, or with -l, set the level
+// that klog() records at (0 off, 1 info, 2 trace).
+
+static char buf[NCPU * KLOGSIZE];
+
+int
+main(int argc, char **argv)
+{
+  int n;
+
+  if(argc == 3 && strcmp(argv[1], "-l") == 0){
+    printf("log level %d -> %s\n", setloglevel(atoi(argv[2])), argv[2]);
+    exit(0);
+  }
+  if(argc != 1){
+    fprintf(2, "usage: dmesg [-l level]\n");
+    exit(1);
+  }
+  if((n = dmesg(buf, sizeof(buf))) < 0){
+    fprintf(2, "dmesg: failed\n");
+    exit(1);
+  }
+  write(1, buf, n);
+  exit(0);
+}
@@ -0,0 +1,143 @@
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "kernel/memlayout.h"
+#include "kernel/trace.h"
+#include "kernel/wait.h"
+#include "user/user.h"
+
+//
+// kernel tracepoint control.
+//
+//   ktrace on [mask]        record the events whose bits are
+//                           set in mask, or all of them
+//   ktrace off              stop recording
+//   ktrace                  print and discard recorded events
+//   ktrace cmd [args ...]   record while cmd runs, then print
+//
+// each event is printed as one line,
+//
+//   <us> cpu <cpu> pid <pid> <event> <args>
+//
+// with times in microseconds since the first event printed.
+//
+
+static char *names[NTRACETYPE] = {
+  [TR_SWITCH]     "switch",
+  [TR_SCHED]      "sched",
+  [TR_SLEEP]      "sleep",
+  [TR_WAKEUP]     "wakeup",
+  [TR_SYSENTER]   "sysenter",
+  [TR_SYSEXIT]    "sysexit",
+  [TR_DISKSUB]    "disksub",
+  [TR_DISKDONE]   "diskdone",
+  [TR_SIGPOST]    "sigpost",
+  [TR_SIGDELIVER] "sigdeliver",
+};
+
+static char *states[] = { "unused", "used", "sleep", "runble", "run", "stop", "zombie" };
+
+static struct traceev evs[NCPU * NTRACE];
+static uint64 t0;
+static int self;  // our own pid, whose events are skipped
+
+static void
+print(struct traceev *e)
+{
+  if(t0 == 0)
+    t0 = e->time;
+  printf("%d cpu %d pid %d %s", (int)((e->time - t0) / (MTIME_FREQ / 1000000)),
+         e->cpu, e->pid, e->type < NTRACETYPE ? names[e->type] : "?");
+  switch(e->type){
+  case TR_SWITCH:
+    printf(" to %d", (int)e->a0);
+    break;
+  case TR_SCHED:
+    printf(" %s", e->a0 < sizeof(states)/sizeof(states[0]) ? states[e->a0] : "?");
+    break;
+  case TR_SLEEP:
+    printf(" chan %p", e->a0);
+    break;
+  case TR_WAKEUP:
+    printf(" %d chan %p", (int)e->a0, e->a1);
+    break;
+  case TR_SYSENTER:
+    printf(" %d arg %p", (int)e->a0, e->a1);
+    break;
+  case TR_SYSEXIT:
+    printf(" %d ret %d", (int)e->a0, (int)e->a1);
+    break;
+  case TR_DISKSUB:
+    printf(" block %d %s", (int)e->a0, e->a1 ? "write" : "read");
+    break;
+  case TR_DISKDONE:
+    printf(" block %d", (int)e->a0);
+    break;
+  case TR_SIGPOST:
+    printf(" to %d sig %d", (int)e->a0, (int)e->a1);
+    break;
+  case TR_SIGDELIVER:
+    printf(" sig %d handler %p", (int)e->a0, e->a1);
+    break;
+  }
+  printf("\n");
+}
+
+// read everything recorded so far in one call, and
+// print it in time order. each CPU's records come out
+// already in order, so the insertion sort just merges
+// the runs.
+static void
+dump(void)
+{
+  struct traceev e;
+  int n, i, j;
+
+  if((n = ktrace(KTRACE_READ, sizeof(evs)/sizeof(evs[0]), evs)) < 0){
+    fprintf(2, "ktrace: read failed\n");
+    exit(1);
+  }
+  for(i = 1; i < n; i++){
+    e = evs[i];
+    for(j = i; j > 0 && evs[j-1].time > e.time; j--)
+      evs[j] = evs[j-1];
+    evs[j] = e;
+  }
+  for(i = 0; i < n; i++)
+    if(evs[i].pid != self)
+      print(&evs[i]);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid;
+
+  if(argc == 1){
+    dump();
+    exit(0);
+  }
+  if(strcmp(argv[1], "on") == 0){
+    ktrace(KTRACE_ON, argc > 2 ? atoi(argv[2]) : 0, 0);
+    exit(0);
+  }
+  if(strcmp(argv[1], "off") == 0){
+    ktrace(KTRACE_OFF, 0, 0);
+    exit(0);
+  }
+
+  self = getpid();
+  ktrace(KTRACE_ON, 0, 0);
+  if((pid = fork()) < 0){
+    fprintf(2, "ktrace: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    exec(argv[1], argv + 1);
+    fprintf(2, "ktrace: exec %s failed\n", argv[1]);
+    exit(1);
+  }
+  waitpid(pid, 0, 0);
+  ktrace(KTRACE_OFF, 0, 0);
+  dump();
+  exit(0);
+}
@@ -0,0 +1,82 @@
+#include "kernel/types.h"
+#include "kernel/prof.h"
+#include "kernel/wait.h"
+#include "user/user.h"
+
+//
+// sampling profiler control.
+//
+//   prof on [period]       sample every period ticks (default 1)
+//   prof off               stop sampling
+//   prof                   print and discard buffered samples
+//   prof cmd [args ...]    sample while cmd runs, then print
+//
+// each sample is printed as one line,
+//
+//   prof <cpu> <pid> <name> <k|u> <pc> <return pc> ...
+//
+// for user/profsym.pl on the host to symbolize.
+//
+
+static struct profsample samples[64];
+
+static void
+dump(void)
+{
+  int n;
+
+  while((n = prof(PROF_READ, 64, samples)) > 0){
+    for(int i = 0; i < n; i++){
+      struct profsample *s = &samples[i];
+      printf("prof %d %d %s %s", s->cpu, s->pid, s->name, s->user ? "u" : "k");
+      for(int j = 0; j < s->depth; j++)
+        printf(" %p", s->pc[j]);
+      printf("\n");
+    }
+  }
+  if(n < 0){
+    fprintf(2, "prof: read failed\n");
+    exit(1);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid;
+
+  if(argc == 1){
+    dump();
+    exit(0);
+  }
+  if(strcmp(argv[1], "on") == 0){
+    if(prof(PROF_ON, argc > 2 ? atoi(argv[2]) : 1, 0) < 0){
+      fprintf(2, "prof: bad period\n");
+      exit(1);
+    }
+    exit(0);
+  }
+  if(strcmp(argv[1], "off") == 0){
+    prof(PROF_OFF, 0, 0);
+    exit(0);
+  }
+
+  prof(PROF_ON, 1, 0);
+  if((pid = fork()) < 0){
+    fprintf(2, "prof: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    exec(argv[1], argv + 1);
+    fprintf(2, "prof: exec %s failed\n", argv[1]);
+    exit(1);
+  }
+  // drain as we go, so the per-CPU buffers don't fill up.
+  while(waitpid(pid, 0, WNOHANG) == 0){
+    dump();
+    sleep(1);
+  }
+  prof(PROF_OFF, 0, 0);
+  dump();
+  exit(0);
+}
@@ -0,0 +1,80 @@
+#!/usr/bin/perl -w
+
+# Symbolize samples printed by the prof program, using
+# the .sym files the Makefile writes next to the kernel
+# and each user program. Run on the host, from the top
+# of the tree, on console output captured while running
+# prof:
+#
+#   perl user/profsym.pl < log
+#
+# Prints the functions most often running when sampled
+# ("self"), those most often on the call chain ("total"),
+# and the most common call chains.
+
+use strict;
+
+my %syms;  # .sym file -> [[addr, name], ...], by addr
+
+sub loadsyms {
+    my $file = shift;
+    return $syms{$file} if exists $syms{$file};
+    my @s;
+    if (open(my $fh, '<', $file)) {
+        while (<$fh>) {
+            next unless /^([0-9a-f]+) (\S+)$/;
+            push @s, [hex($1), $2];
+        }
+        close($fh);
+    }
+    @s = sort { $a->[0] <=> $b->[0] } @s;
+    return $syms{$file} = \@s;
+}
+
+# the name of the function containing pc, or pc in hex.
+sub lookup {
+    my ($s, $pc) = @_;
+    my ($lo, $hi) = (0, scalar(@$s) - 1);
+    return sprintf("0x%x", $pc) if $hi < 0 || $pc < $s->[0][0];
+    while ($lo < $hi) {
+        my $mid = int(($lo + $hi + 1) / 2);
+        if ($s->[$mid][0] <= $pc) { $lo = $mid; } else { $hi = $mid - 1; }
+    }
+    return $s->[$lo][1];
+}
+
+my (%self, %total, %chains);
+my $n = 0;
+
+while (<>) {
+    next unless /^prof (\d+) (\d+) (\S+) ([ku])((?: 0x[0-9a-f]+)+)\s*$/;
+    my ($name, $where, @pcs) = ($3, $4, map { hex } split(' ', $5));
+    my $s = loadsyms($where eq 'k' ? "kernel/kernel.sym" : "user/$name.sym");
+    my $tag = $where eq 'k' ? "[k]" : "[$name]";
+    my @fns;
+    for (my $i = 0; $i < @pcs; $i++) {
+        # return addresses point after the call.
+        push @fns, "$tag " . lookup($s, $i == 0 ? $pcs[$i] : $pcs[$i] - 1);
+    }
+    $self{$fns[0]}++;
+    my %seen;
+    $total{$_}++ for grep { !$seen{$_}++ } @fns;
+    $chains{join(" <- ", @fns)}++;
+    $n++;
+}
+
+die "profsym: no samples\n" if $n == 0;
+
+sub top {
+    my ($title, $h, $max) = @_;
+    print "$title\n";
+    my @k = sort { $h->{$b} <=> $h->{$a} || $a cmp $b } keys %$h;
+    splice(@k, $max) if @k > $max;
+    printf("%6d %5.1f%%  %s\n", $h->{$_}, 100 * $h->{$_} / $n, $_) for @k;
+    print "\n";
+}
+
+print "$n samples\n\n";
+top("self", \%self, 30);
+top("total", \%total, 30);
+top("chains", \%chains, 20);
@@ -0,0 +1,299 @@
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "kernel/memlayout.h"
+#include "kernel/signals.h"
+#include "kernel/wait.h"
+#include "user/user.h"
+
+//
+// signal delivery benchmarks.
+//
+// usage: sigbench [-n iters] [-p maxprocs] [test ...]
+//
+// each test is run by 1, 2, 4, ... up to maxprocs copies at
+// once, and prints one line per run:
+//
+//   sigbench <test> procs <p> iters <n> ns/op <x> ops/s <y>
+//
+// ns/op is the mean over the copies of each one's time per
+// operation; ops/s is the total rate of all copies together.
+// time comes from the time CSR, which user code can read.
+//
+
+#define SIGBENCH 10   // the signal most tests send
+
+static volatile int caught;
+
+static void
+onsignal(int sig)
+{
+  caught++;
+}
+
+static uint64
+now(void)
+{
+  uint64 x;
+  asm volatile("rdtime %0" : "=r" (x));
+  return x;
+}
+
+static void
+catch(int sig)
+{
+  struct sigaction act = { onsignal, 0 };
+
+  if(sigaction(sig, &act, 0) < 0){
+    fprintf(2, "sigbench: sigaction failed\n");
+    exit(1);
+  }
+}
+
+// a child that answers each SIGBENCH it takes with one
+// of its own to the parent. it is killed when done.
+static int
+echoer(int ppid)
+{
+  int pid;
+
+  if((pid = fork()) < 0){
+    fprintf(2, "sigbench: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    for(;;){
+      if(sigwaitinfo(1 << SIGBENCH, 0) == SIGBENCH)
+        kill(ppid, SIGBENCH);
+    }
+  }
+  return pid;
+}
+
+static int replyto;
+
+static void
+reply(int sig)
+{
+  kill(replyto, SIGBENCH);
+}
+
+// a child that spins making system calls, so that a
+// SIGSTOP takes effect at once, and answers each SIGBENCH
+// from a handler. it is killed when done.
+static int
+spinner(int ppid)
+{
+  int pid;
+
+  if((pid = fork()) < 0){
+    fprintf(2, "sigbench: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    struct sigaction act = { reply, 0 };
+
+    replyto = ppid;
+    sigaction(SIGBENCH, &act, 0);
+    sigprocmask(0);
+    for(;;)
+      getpgid(0);
+  }
+  return pid;
+}
+
+static void
+reap(int pid)
+{
+  kill(pid, SIGKILL);
+  waitpid(pid, 0, 0);
+}
+
+// round trip: send to an echoer, wait for its answer.
+static int
+pingpong(int n)
+{
+  int pid = echoer(getpid());
+
+  for(int i = 0; i < n; i++){
+    kill(pid, SIGBENCH);
+    sigwaitinfo(1 << SIGBENCH, 0);
+  }
+  reap(pid);
+  return n;
+}
+
+// signal ourselves; each kill() returns through a handler.
+static int
+handlers(int n)
+{
+  int pid = getpid();
+
+  sigprocmask(0);
+  catch(SIGBENCH);
+  caught = 0;
+  for(int i = 0; i < n; i++)
+    kill(pid, SIGBENCH);
+  if(caught != n)
+    fprintf(2, "sigbench: handlers: caught %d of %d\n", caught, n);
+  return n;
+}
+
+// queue a full batch while blocked, then unblock. the
+// handler blocks SIGBENCH while it runs, so the batch is
+// taken one copy per sigret(), each from the kernel's
+// queue without another kill() in between.
+static int
+batch(int n)
+{
+  int pid = getpid();
+  int ops = 0;
+
+  catch(SIGBENCH);
+  caught = 0;
+  for(int i = 0; i < n; i += NSIGQUEUE){
+    sigprocmask(1 << SIGBENCH);
+    for(int j = 0; j < NSIGQUEUE; j++)
+      sigqueue(pid, SIGBENCH, j);
+    sigprocmask(0);
+    ops += NSIGQUEUE;
+  }
+  if(caught != ops)
+    fprintf(2, "sigbench: batch: caught %d of %d\n", caught, ops);
+  return ops;
+}
+
+static int
+procmask(int n)
+{
+  for(int i = 0; i < n; i++){
+    sigprocmask(1 << SIGBENCH);
+    sigprocmask(0);
+  }
+  return 2 * n;
+}
+
+// stop a spinner, wait until it has stopped, send it a
+// signal, continue it, and wait for the answer, which it
+// can only give once it runs again.
+static int
+stopcont(int n)
+{
+  int pid = spinner(getpid());
+
+  for(int i = 0; i < n; i++){
+    kill(pid, SIGSTOP);
+    if(waitpid(pid, 0, WUNTRACED) != pid){
+      fprintf(2, "sigbench: stopcont: child didn't stop\n");
+      break;
+    }
+    kill(pid, SIGBENCH);
+    kill(pid, SIGCONT);
+    sigwaitinfo(1 << SIGBENCH, 0);
+  }
+  reap(pid);
+  return n;
+}
+
+struct test {
+  char *name;
+  int (*fn)(int);
+} tests[] = {
+  { "pingpong", pingpong },
+  { "handler", handlers },
+  { "batch", batch },
+  { "sigprocmask", procmask },
+  { "stopcont", stopcont },
+};
+
+#define NTEST (sizeof(tests) / sizeof(tests[0]))
+
+// run p copies of t at once; each reports its ops and
+// elapsed time through the pipe.
+static void
+run(struct test *t, int p, int n)
+{
+  int fds[2];
+  uint64 start, r[2], elapsed, nsop, ops;
+
+  if(pipe(fds) < 0){
+    fprintf(2, "sigbench: pipe failed\n");
+    exit(1);
+  }
+  start = now();
+  for(int i = 0; i < p; i++){
+    int pid = fork();
+    if(pid < 0){
+      fprintf(2, "sigbench: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      uint64 t0;
+
+      close(fds[0]);
+      // echoes arrive as SIGBENCH, taken by sigwaitinfo().
+      sigprocmask(1 << SIGBENCH);
+      t0 = now();
+      r[0] = t->fn(n);
+      r[1] = now() - t0;
+      write(fds[1], r, sizeof(r));
+      exit(0);
+    }
+  }
+  close(fds[1]);
+  nsop = 0;
+  ops = 0;
+  for(int i = 0; i < p; i++){
+    if(read(fds[0], r, sizeof(r)) != sizeof(r)){
+      fprintf(2, "sigbench: %s: lost a result\n", t->name);
+      exit(1);
+    }
+    ops += r[0];
+    nsop += r[1] * (1000000000 / MTIME_FREQ) / r[0];
+  }
+  elapsed = now() - start;
+  close(fds[0]);
+  for(int i = 0; i < p; i++)
+    wait(0);
+  printf("sigbench %s procs %d iters %d ns/op %d ops/s %d\n",
+         t->name, p, n, (int)(nsop / p),
+         (int)(ops * MTIME_FREQ / (elapsed ? elapsed : 1)));
+}
+
+int
+main(int argc, char *argv[])
+{
+  int n = 10000, maxp = 1, ran = 0;
+  int i;
+
+  for(i = 1; i < argc && argv[i][0] == '-'; i += 2){
+    if(i + 1 >= argc)
+      goto usage;
+    if(strcmp(argv[i], "-n") == 0)
+      n = atoi(argv[i+1]);
+    else if(strcmp(argv[i], "-p") == 0)
+      maxp = atoi(argv[i+1]);
+    else
+      goto usage;
+  }
+  if(n <= 0 || maxp <= 0)
+    goto usage;
+
+  for(int t = 0; t < NTEST; t++){
+    int want = i == argc;
+    for(int j = i; j < argc; j++)
+      if(strcmp(argv[j], tests[t].name) == 0)
+        want = 1;
+    if(!want)
+      continue;
+    for(int p = 1; p <= maxp; p *= 2)
+      run(&tests[t], p, n);
+    ran++;
+  }
+  if(ran == 0)
+    goto usage;
+  exit(0);
+
+usage:
+  fprintf(2, "usage: sigbench [-n iters] [-p maxprocs] [test ...]\n");
+  exit(1);
+}
@@ -0,0 +1,185 @@
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "kernel/memlayout.h"
+#include "kernel/syscall.h"
+#include "kernel/sysstat.h"
+#include "user/user.h"
+
+//
+// system call accounting.
+//
+//   sysstat                 print the counts
+//   sysstat on [pid]        count calls, by pid only if given
+//   sysstat off             stop counting
+//   sysstat reset           zero the counts
+//   sysstat idle [ticks]    print how much of the next ticks
+//                           (default 10) each CPU spent idle
+//   sysstat cmd [args ...]  count only cmd's calls, and print
+//                           them when it exits
+//
+
+static char *names[NSYSSTAT] = {
+  [SYS_fork] "fork",
+  [SYS_exit] "exit",
+  [SYS_wait] "wait",
+  [SYS_pipe] "pipe",
+  [SYS_read] "read",
+  [SYS_kill] "kill",
+  [SYS_exec] "exec",
+  [SYS_fstat] "fstat",
+  [SYS_chdir] "chdir",
+  [SYS_dup] "dup",
+  [SYS_getpid] "getpid",
+  [SYS_sbrk] "sbrk",
+  [SYS_sleep] "sleep",
+  [SYS_uptime] "uptime",
+  [SYS_open] "open",
+  [SYS_write] "write",
+  [SYS_mknod] "mknod",
+  [SYS_unlink] "unlink",
+  [SYS_link] "link",
+  [SYS_mkdir] "mkdir",
+  [SYS_close] "close",
+  [SYS_sigprocmask] "sigprocmask",
+  [SYS_sigaction] "sigaction",
+  [SYS_sigret] "sigret",
+  [SYS_nanosleep] "nanosleep",
+  [SYS_nice] "nice",
+  [SYS_setpriority] "setpriority",
+  [SYS_sigqueue] "sigqueue",
+  [SYS_sigwaitinfo] "sigwaitinfo",
+  [SYS_signalfd] "signalfd",
+  [SYS_waitpid] "waitpid",
+  [SYS_setitimer] "setitimer",
+  [SYS_setpgid] "setpgid",
+  [SYS_getpgid] "getpgid",
+  [SYS_dmesg] "dmesg",
+  [SYS_setloglevel] "setloglevel",
+  [SYS_ring_setup] "ring_setup",
+  [SYS_ring_enter] "ring_enter",
+  [SYS_sysstat] "sysstat",
+  [SYS_prof] "prof",
+  [SYS_ktrace] "ktrace",
+};
+
+static struct sysstat stats[NSYSSTAT];
+
+static int
+ns(uint64 t)
+{
+  return t * (1000000000 / MTIME_FREQ);
+}
+
+static void
+show(void)
+{
+  if(sysstat(SYSSTAT_READ, 0, stats) < 0){
+    fprintf(2, "sysstat: read failed\n");
+    exit(1);
+  }
+  printf("syscall count avg-ns\n");
+  for(int i = 0; i < NSYSSTAT; i++){
+    struct sysstat *s = &stats[i];
+    if(s->count == 0)
+      continue;
+    printf("%s %d %d\n", names[i] ? names[i] : "?", (int)s->count,
+           ns(s->time / s->count));
+    for(int b = 0; b < NSYSHIST; b++){
+      if(s->hist[b] == 0)
+        continue;
+      // past 2^24 ticks, ns would overflow an int.
+      if(b < 24)
+        printf("  < %d ns: %d\n", ns(2L << b), (int)s->hist[b]);
+      else
+        printf("  < %d us: %d\n", (int)((2L << b) / (MTIME_FREQ / 1000000)), (int)s->hist[b]);
+    }
+  }
+}
+
+static uint64 idle0[NCPU], idle1[NCPU];
+
+static uint64
+now(void)
+{
+  uint64 x;
+  asm volatile("rdtime %0" : "=r" (x));
+  return x;
+}
+
+// CPUs that have never gone idle, or don't exist, are
+// left out.
+static void
+idle(int n)
+{
+  uint64 t0, t;
+
+  if(sysstat(SYSSTAT_IDLE, 0, (struct sysstat *)idle0) < 0){
+    fprintf(2, "sysstat: read failed\n");
+    exit(1);
+  }
+  t0 = now();
+  sleep(n);
+  sysstat(SYSSTAT_IDLE, 0, (struct sysstat *)idle1);
+  t = now() - t0;
+  printf("cpu idle-ms idle-%%\n");
+  for(int i = 0; i < NCPU; i++){
+    if(idle1[i] == 0)
+      continue;
+    printf("%d %d %d\n", i, (int)((idle1[i] - idle0[i]) / (MTIME_FREQ / 1000)),
+           (int)((idle1[i] - idle0[i]) * 100 / t));
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int fds[2], pid;
+  char c;
+
+  if(argc == 1){
+    show();
+    exit(0);
+  }
+  if(strcmp(argv[1], "on") == 0){
+    sysstat(SYSSTAT_ON, argc > 2 ? atoi(argv[2]) : 0, 0);
+    exit(0);
+  }
+  if(strcmp(argv[1], "off") == 0){
+    sysstat(SYSSTAT_OFF, 0, 0);
+    exit(0);
+  }
+  if(strcmp(argv[1], "reset") == 0){
+    sysstat(SYSSTAT_RESET, 0, 0);
+    exit(0);
+  }
+  if(strcmp(argv[1], "idle") == 0){
+    idle(argc > 2 ? atoi(argv[2]) : 10);
+    exit(0);
+  }
+
+  // hold the child until counting is set up for its pid.
+  if(pipe(fds) < 0){
+    fprintf(2, "sysstat: pipe failed\n");
+    exit(1);
+  }
+  if((pid = fork()) < 0){
+    fprintf(2, "sysstat: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    close(fds[1]);
+    read(fds[0], &c, 1);
+    close(fds[0]);
+    exec(argv[1], argv + 1);
+    fprintf(2, "sysstat: exec %s failed\n", argv[1]);
+    exit(1);
+  }
+  close(fds[0]);
+  sysstat(SYSSTAT_RESET, 0, 0);
+  sysstat(SYSSTAT_ON, pid, 0);
+  close(fds[1]);
+  waitpid(pid, 0, 0);
+  sysstat(SYSSTAT_OFF, 0, 0);
+  show();
+  exit(0);
+}
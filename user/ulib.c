@@ -1,6 +1,8 @@
 #include "kernel/types.h"
 #include "kernel/stat.h"
 #include "kernel/fcntl.h"
+#include "kernel/riscv.h"
+#include "kernel/memlayout.h"
 #include "user/user.h"
 
 char*
@@ -134,3 +136,37 @@ memcpy(void *dst, const void *src, uint n)
 {
   return memmove(dst, src, n);
 }
+
+// SIGALRM in n clock ticks; 0 cancels.
+// returns the ticks left on the previous alarm.
+int
+alarm(int n)
+{
+  return setitimer(n, 0);
+}
+
+// getpid(), uptime() and nanotime() read pages the kernel
+// maps into every process (see memlayout.h), so they
+// don't need a system call.
+
+int
+getpid(void)
+{
+  return ((struct usyscall *)USYSCALL)->pid;
+}
+
+int
+uptime(void)
+{
+  return ((volatile struct vdso *)VDSO)->ticks;
+}
+
+// nanoseconds since boot, from the time CSR.
+uint64
+nanotime(void)
+{
+  uint64 t;
+
+  asm volatile("rdtime %0" : "=r" (t));
+  return t * (1000000000 / ((struct vdso *)VDSO)->timefreq);
+}
@@ -1,6 +1,11 @@
 struct stat;
 struct rtcdate;
 struct sigaction;
+struct siginfo;
+struct ring;
+struct sysstat;
+struct profsample;
+struct traceev;
 // system calls
 int fork(void);
 int exit(int) __attribute__((noreturn));
@@ -26,6 +31,23 @@ int uptime(void);
 uint sigprocmask(uint sigmask);
 int sigaction(int signum, const struct sigaction *act, struct sigaction *oldact);
 void sigret(void);
+int nanosleep(uint64);
+int nice(int);
+int setpriority(int, int);
+int sigqueue(int, int, uint64);
+int sigwaitinfo(uint, struct siginfo*);
+int signalfd(uint);
+int waitpid(int, int*, int);
+int setitimer(int, int);
+int setpgid(int, int);
+int getpgid(int);
+int dmesg(char*, int);
+int setloglevel(int);
+int ring_setup(struct ring*, int);
+int ring_enter(int);
+int sysstat(int, int, struct sysstat*);
+int prof(int, int, struct profsample*);
+int ktrace(int, int, struct traceev*);
 
 
 // ulib.c
@@ -42,5 +64,7 @@ void* memset(void*, int, uint);
 void* malloc(uint);
 void free(void*);
 int atoi(const char*);
+int alarm(int);
 int memcmp(const void *, const void *, uint);
+uint64 nanotime(void);
 void *memcpy(void *, const void *, uint);
@@ -32,10 +32,25 @@ entry("link");
 entry("mkdir");
 entry("chdir");
 entry("dup");
-entry("getpid");
 entry("sbrk");
 entry("sleep");
-entry("uptime");
 entry("sigprocmask");
 entry("sigaction");
 entry("sigret");
+entry("nanosleep");
+entry("nice");
+entry("setpriority");
+entry("sigqueue");
+entry("sigwaitinfo");
+entry("signalfd");
+entry("waitpid");
+entry("setitimer");
+entry("setpgid");
+entry("getpgid");
+entry("dmesg");
+entry("setloglevel");
+entry("ring_setup");
+entry("ring_enter");
+entry("sysstat");
+entry("prof");
+entry("ktrace");